@@ -0,0 +1,338 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Commandlets/PCGWaterBenchmarkCommandlet.h"
+
+#include "Data/PCGPointData.h"
+#include "Data/PCGWaterData.h"
+#include "Elements/PCGWaterGetter.h"
+#include "PCGComponent.h"
+#include "PCGContext.h"
+#include "PCGModule.h"
+#include "WaterBodyLakeActor.h"
+#include "WaterBodyOceanActor.h"
+#include "WaterBodyRiverActor.h"
+#include "WaterSplineComponent.h"
+
+#include "Async/TaskGraphInterfaces.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "HAL/PlatformMemory.h"
+#include "Math/RandomStream.h"
+#include "Misc/FileHelper.h"
+
+namespace UE::PCGWaterInterop::Private
+{
+	// Each body is laid out in its own square cell, lakes are circles inside their cell and rivers cross it.
+	constexpr double BenchmarkCellSize = 20000.0;
+	constexpr double BenchmarkLakeRadius = 8000.0;
+	constexpr int32 BenchmarkRiverEvery = 4;
+	constexpr int32 BenchmarkLakeSplinePoints = 8;
+	constexpr int32 BenchmarkRandomSeed = 42;
+
+	TArray<int32> ParseCounts(const FString& InParams, const TCHAR* InKey, TArray<int32> InDefaultCounts)
+	{
+		FString Value;
+		if (!FParse::Value(*InParams, InKey, Value, /*bShouldStopOnSeparator=*/false))
+		{
+			return InDefaultCounts;
+		}
+
+		TArray<FString> Tokens;
+		Value.ParseIntoArray(Tokens, TEXT(","));
+
+		TArray<int32> Counts;
+		for (const FString& Token : Tokens)
+		{
+			const int32 Count = FCString::Atoi(*Token);
+			if (Count > 0)
+			{
+				Counts.Add(Count);
+			}
+		}
+
+		return Counts.IsEmpty() ? InDefaultCounts : Counts;
+	}
+
+	void SetSplinePoints(AWaterBody* InWaterBody, TConstArrayView<FVector> InPoints, bool bInClosedLoop)
+	{
+		UWaterSplineComponent* WaterSpline = InWaterBody->GetWaterSpline();
+		check(WaterSpline);
+
+		WaterSpline->ClearSplinePoints(/*bUpdateSpline=*/false);
+		for (const FVector& Point : InPoints)
+		{
+			WaterSpline->AddSplinePoint(Point, ESplineCoordinateSpace::World, /*bUpdateSpline=*/false);
+		}
+
+		WaterSpline->SetClosedLoop(bInClosedLoop, /*bUpdateSpline=*/false);
+		WaterSpline->UpdateSpline();
+
+#if WITH_EDITOR
+		// Lets the water body rebuild its shape from the new spline.
+		WaterSpline->K2_SynchronizeAndBroadcastDataChange();
+#endif
+	}
+
+	struct FMemorySnapshot
+	{
+		FMemorySnapshot() : UsedPhysical(FPlatformMemory::GetStats().UsedPhysical) {}
+
+		void Finish(int64& OutUsedPhysicalDelta, uint64& OutPeakUsedPhysical) const
+		{
+			const FPlatformMemoryStats Stats = FPlatformMemory::GetStats();
+			OutUsedPhysicalDelta = static_cast<int64>(Stats.UsedPhysical) - static_cast<int64>(UsedPhysical);
+			OutPeakUsedPhysical = Stats.PeakUsedPhysical;
+		}
+
+		uint64 UsedPhysical = 0;
+	};
+}
+
+UPCGWaterBenchmarkCommandlet::UPCGWaterBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UPCGWaterBenchmarkCommandlet::Main(const FString& Params)
+{
+	using namespace UE::PCGWaterInterop::Private;
+
+	const TArray<int32> PointCounts = ParseCounts(Params, TEXT("Points="), { 10000, 100000, 1000000 });
+	const TArray<int32> BodyCounts = ParseCounts(Params, TEXT("Bodies="), { 1, 10, 100, 1000 });
+	const bool bWithOcean = FParse::Param(*Params, TEXT("Ocean"));
+
+	FString CsvPath;
+	FParse::Value(*Params, TEXT("Csv="), CsvPath);
+
+	if (!GEngine)
+	{
+		UE_LOG(LogPCG, Error, TEXT("PCGWaterBenchmark: no engine to create the benchmark world with."));
+		return 1;
+	}
+
+	TArray<FResult> Results;
+
+	for (const int32 NumBodies : BodyCounts)
+	{
+		// A fresh world per body count, so the water subsystems only see the bodies of this run.
+		UWorld* World = UWorld::CreateWorld(EWorldType::Game, /*bInformEngineOfWorld=*/false, TEXT("PCGWaterBenchmark"));
+		FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+		WorldContext.SetCurrentWorld(World);
+
+		RunBenchmarks(World, NumBodies, PointCounts, bWithOcean, Results);
+
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(/*bInformEngineOfWorld=*/false);
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	}
+
+	FString Csv = TEXT("Benchmark,Bodies,Points,Hits,Seconds,PointsPerSecond,UsedPhysicalDeltaMB,PeakUsedPhysicalMB\n");
+
+	UE_LOG(LogPCG, Display, TEXT("%-16s %8s %10s %10s %10s %14s %10s %10s"), TEXT("Benchmark"), TEXT("Bodies"), TEXT("Points"), TEXT("Hits"), TEXT("Seconds"), TEXT("Points/s"), TEXT("DeltaMB"), TEXT("PeakMB"));
+	for (const FResult& Result : Results)
+	{
+		const double PointsPerSecond = Result.Seconds > 0.0 ? Result.NumPoints / Result.Seconds : 0.0;
+		const double UsedPhysicalDeltaMB = Result.UsedPhysicalDelta / (1024.0 * 1024.0);
+		const double PeakUsedPhysicalMB = Result.PeakUsedPhysical / (1024.0 * 1024.0);
+
+		UE_LOG(LogPCG, Display, TEXT("%-16s %8d %10d %10d %10.4f %14.0f %10.1f %10.1f"), *Result.Name, Result.NumBodies, Result.NumPoints, Result.NumHits, Result.Seconds, PointsPerSecond, UsedPhysicalDeltaMB, PeakUsedPhysicalMB);
+		Csv += FString::Printf(TEXT("%s,%d,%d,%d,%f,%f,%f,%f\n"), *Result.Name, Result.NumBodies, Result.NumPoints, Result.NumHits, Result.Seconds, PointsPerSecond, UsedPhysicalDeltaMB, PeakUsedPhysicalMB);
+	}
+
+	if (!CsvPath.IsEmpty() && !FFileHelper::SaveStringToFile(Csv, *CsvPath))
+	{
+		UE_LOG(LogPCG, Error, TEXT("PCGWaterBenchmark: could not write results to '%s'."), *CsvPath);
+		return 1;
+	}
+
+	return 0;
+}
+
+void UPCGWaterBenchmarkCommandlet::RunBenchmarks(UWorld* World, int32 NumBodies, TConstArrayView<int32> PointCounts, bool bWithOcean, TArray<FResult>& OutResults) const
+{
+	using namespace UE::PCGWaterInterop::Private;
+
+	TArray<TWeakObjectPtr<AWaterBody>> WaterBodies;
+	FBox Bounds(EForceInit::ForceInit);
+	SpawnWaterBodies(World, NumBodies, bWithOcean, WaterBodies, Bounds);
+
+	OutResults.Add(RunGetWaterDataElement(World, NumBodies));
+
+	UPCGWaterData* WaterData = NewObject<UPCGWaterData>();
+	WaterData->AddToRoot();
+	WaterData->Initialize(WaterBodies, Bounds, /*bInUseMetadata=*/true);
+
+	FPCGContext Context;
+	Context.AsyncState.NumAvailableTasks = FMath::Max(1, FTaskGraphInterface::Get().GetNumWorkerThreads());
+
+	const FBox PointBounds(FVector(-50.0), FVector(50.0));
+	FPCGProjectionParams ProjectionParams;
+
+	for (const int32 NumPoints : PointCounts)
+	{
+		FRandomStream RandomStream(BenchmarkRandomSeed);
+
+		// Random locations over the bodies, from below to above the water level so some are immersed and some aren't.
+		TArray<FPCGPoint> Points;
+		Points.SetNum(NumPoints);
+		for (FPCGPoint& Point : Points)
+		{
+			Point.Transform.SetLocation(FVector(
+				RandomStream.FRandRange(Bounds.Min.X, Bounds.Max.X),
+				RandomStream.FRandRange(Bounds.Min.Y, Bounds.Max.Y),
+				RandomStream.FRandRange(-1000.0, 1000.0)));
+			Point.SetLocalBounds(PointBounds);
+		}
+
+		auto RunBenchmark = [NumBodies, NumPoints, &OutResults](const TCHAR* InName, TFunctionRef<int32()> InFunc)
+		{
+			FResult& Result = OutResults.Emplace_GetRef();
+			Result.Name = InName;
+			Result.NumBodies = NumBodies;
+			Result.NumPoints = NumPoints;
+
+			const FMemorySnapshot MemorySnapshot;
+			const double StartTime = FPlatformTime::Seconds();
+			Result.NumHits = InFunc();
+			Result.Seconds = FPlatformTime::Seconds() - StartTime;
+			MemorySnapshot.Finish(Result.UsedPhysicalDelta, Result.PeakUsedPhysical);
+		};
+
+		RunBenchmark(TEXT("ProjectPoint"), [&Points, WaterData, &PointBounds, &ProjectionParams]()
+		{
+			int32 NumHits = 0;
+			FPCGPoint OutPoint;
+			for (const FPCGPoint& Point : Points)
+			{
+				NumHits += WaterData->ProjectPoint(Point.Transform, PointBounds, ProjectionParams, OutPoint, nullptr) ? 1 : 0;
+			}
+
+			return NumHits;
+		});
+
+		RunBenchmark(TEXT("SamplePoint"), [&Points, WaterData, &PointBounds]()
+		{
+			int32 NumHits = 0;
+			FPCGPoint OutPoint;
+			for (const FPCGPoint& Point : Points)
+			{
+				NumHits += WaterData->SamplePoint(Point.Transform, PointBounds, OutPoint, nullptr) ? 1 : 0;
+			}
+
+			return NumHits;
+		});
+
+		RunBenchmark(TEXT("ProjectPoints"), [&Points, WaterData, &ProjectionParams]()
+		{
+			TArray<FPCGPoint> ProjectedPoints = Points;
+			return WaterData->ProjectPoints(ProjectedPoints, ProjectionParams, nullptr);
+		});
+
+		// Point spacing giving about NumPoints grid cells over the bounds.
+		const FVector BoundsSize = Bounds.GetSize();
+		WaterData->PointSpacing = static_cast<float>(FMath::Max(1.0, FMath::Sqrt(BoundsSize.X * BoundsSize.Y / NumPoints)));
+
+		RunBenchmark(TEXT("CreatePointData"), [WaterData, &Context]()
+		{
+			const UPCGPointData* PointData = WaterData->CreatePointData(&Context);
+			return PointData ? PointData->GetPoints().Num() : 0;
+		});
+
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	}
+
+	WaterData->RemoveFromRoot();
+}
+
+void UPCGWaterBenchmarkCommandlet::SpawnWaterBodies(UWorld* World, int32 NumBodies, bool bWithOcean, TArray<TWeakObjectPtr<AWaterBody>>& OutWaterBodies, FBox& OutBounds) const
+{
+	using namespace UE::PCGWaterInterop::Private;
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(UPCGWaterBenchmarkCommandlet::SpawnWaterBodies);
+
+	const int32 BodiesPerRow = FMath::Max(1, FMath::CeilToInt32(FMath::Sqrt(static_cast<double>(NumBodies))));
+	const int32 NumRows = FMath::DivideAndRoundUp(NumBodies, BodiesPerRow);
+
+	OutBounds = FBox(FVector(0.0, 0.0, -2000.0), FVector(BodiesPerRow * BenchmarkCellSize, NumRows * BenchmarkCellSize, 2000.0));
+
+	for (int32 BodyIndex = 0; BodyIndex < NumBodies; ++BodyIndex)
+	{
+		const FVector CellMin(BodyIndex % BodiesPerRow * BenchmarkCellSize, BodyIndex / BodiesPerRow * BenchmarkCellSize, 0.0);
+		const FVector CellCenter = CellMin + FVector(0.5 * BenchmarkCellSize, 0.5 * BenchmarkCellSize, 0.0);
+
+		if (BodyIndex % BenchmarkRiverEvery == BenchmarkRiverEvery - 1)
+		{
+			AWaterBodyRiver* River = World->SpawnActor<AWaterBodyRiver>(CellCenter, FRotator::ZeroRotator);
+			const FVector RiverPoints[] = { CellMin + FVector(0.0, 0.5 * BenchmarkCellSize, 0.0), CellCenter, CellMin + FVector(BenchmarkCellSize, 0.5 * BenchmarkCellSize, 0.0) };
+			SetSplinePoints(River, RiverPoints, /*bInClosedLoop=*/false);
+			OutWaterBodies.Add(River);
+		}
+		else
+		{
+			AWaterBodyLake* Lake = World->SpawnActor<AWaterBodyLake>(CellCenter, FRotator::ZeroRotator);
+
+			TArray<FVector, TInlineAllocator<BenchmarkLakeSplinePoints>> LakePoints;
+			for (int32 PointIndex = 0; PointIndex < BenchmarkLakeSplinePoints; ++PointIndex)
+			{
+				const double Angle = UE_TWO_PI * PointIndex / BenchmarkLakeSplinePoints;
+				LakePoints.Add(CellCenter + FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.0) * BenchmarkLakeRadius);
+			}
+
+			SetSplinePoints(Lake, LakePoints, /*bInClosedLoop=*/true);
+			OutWaterBodies.Add(Lake);
+		}
+	}
+
+	if (bWithOcean)
+	{
+		// The ocean shoreline surrounds all the other bodies, so every location is a candidate for it.
+		AWaterBodyOcean* Ocean = World->SpawnActor<AWaterBodyOcean>(OutBounds.GetCenter() * FVector(1.0, 1.0, 0.0), FRotator::ZeroRotator);
+		const FVector OceanPoints[] = { FVector(OutBounds.Min.X, OutBounds.Min.Y, 0.0), FVector(OutBounds.Max.X, OutBounds.Min.Y, 0.0), FVector(OutBounds.Max.X, OutBounds.Max.Y, 0.0), FVector(OutBounds.Min.X, OutBounds.Max.Y, 0.0) };
+		SetSplinePoints(Ocean, OceanPoints, /*bInClosedLoop=*/true);
+		OutWaterBodies.Add(Ocean);
+	}
+}
+
+UPCGWaterBenchmarkCommandlet::FResult UPCGWaterBenchmarkCommandlet::RunGetWaterDataElement(UWorld* World, int32 NumBodies) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UPCGWaterBenchmarkCommandlet::RunGetWaterDataElement);
+
+	AActor* Owner = World->SpawnActor<AActor>();
+	UPCGComponent* Component = NewObject<UPCGComponent>(Owner);
+	Component->RegisterComponent();
+
+	UPCGGetWaterSettings* Settings = NewObject<UPCGGetWaterSettings>();
+	Settings->ActorSelector.ActorFilter = EPCGActorFilter::AllWorldActors;
+	Settings->ActorSelector.ActorSelection = EPCGActorSelection::ByClass;
+	Settings->ActorSelector.ActorSelectionClass = AWaterBody::StaticClass();
+	Settings->ActorSelector.bSelectMultiple = true;
+
+	FResult Result;
+	Result.Name = TEXT("GetWaterData");
+	Result.NumBodies = NumBodies;
+
+	const UE::PCGWaterInterop::Private::FMemorySnapshot MemorySnapshot;
+	const double StartTime = FPlatformTime::Seconds();
+
+	FPCGElementPtr Element = Settings->GetElement();
+	FPCGContext* Context = Element->Initialize(FPCGDataCollection(), Component, nullptr);
+	Context->AsyncState.NumAvailableTasks = FMath::Max(1, FTaskGraphInterface::Get().GetNumWorkerThreads());
+	Context->InputData.TaggedData.Emplace_GetRef().Data = Settings;
+
+	// Nothing else runs in the commandlet, so the element is simply executed until done.
+	while (!Element->Execute(Context))
+	{
+	}
+
+	Result.NumHits = Context->OutputData.TaggedData.Num();
+	delete Context;
+
+	Result.Seconds = FPlatformTime::Seconds() - StartTime;
+	MemorySnapshot.Finish(Result.UsedPhysicalDelta, Result.PeakUsedPhysical);
+
+	Owner->Destroy();
+	return Result;
+}
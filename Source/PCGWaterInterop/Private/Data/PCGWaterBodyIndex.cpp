@@ -0,0 +1,204 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Data/PCGWaterBodyIndex.h"
+
+#include "Algo/Unique.h"
+
+namespace UE::PCGWaterInterop::Private
+{
+	// Keeps the grid small enough to build quickly while keeping a handful of bodies per cell at most.
+	constexpr int32 MaxGridCellsPerAxis = 256;
+	constexpr int32 TargetCellsPerBody = 4;
+
+	/** Cell containing a grid-relative coordinate, clamped to the grid. Clamped in double first, unbounded bodies are far out of the int32 range. */
+	int32 GetCellCoordinate(double InLocal, int32 InGridSize)
+	{
+		return FMath::FloorToInt32(FMath::Clamp(InLocal, 0.0, static_cast<double>(InGridSize - 1)));
+	}
+}
+
+void FPCGWaterBodyIndex::Build(TConstArrayView<FBox> InBodyBounds)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FPCGWaterBodyIndex::Build);
+
+	using namespace UE::PCGWaterInterop::Private;
+
+	NumBodies = InBodyBounds.Num();
+	BodyBounds.Reset(NumBodies);
+	UnboundedBodies.Reset();
+	GridBounds = FBox2D(EForceInit::ForceInit);
+
+	const FBox2D UnboundedBox(FVector2D(-UE_BIG_NUMBER), FVector2D(UE_BIG_NUMBER));
+
+	for (int32 BodyIndex = 0; BodyIndex < NumBodies; ++BodyIndex)
+	{
+		const FBox& Bounds = InBodyBounds[BodyIndex];
+		if (Bounds.IsValid)
+		{
+			const FBox2D& BodyBox = BodyBounds.Emplace_GetRef(FVector2D(Bounds.Min), FVector2D(Bounds.Max));
+			GridBounds += BodyBox;
+		}
+		else
+		{
+			BodyBounds.Add(UnboundedBox);
+			UnboundedBodies.Add(BodyIndex);
+		}
+	}
+
+	CellStarts.Reset();
+	CellBodies.Reset();
+	GridSize = FIntPoint::ZeroValue;
+
+	if (!GridBounds.bIsValid)
+	{
+		return;
+	}
+
+	// Aim for a square-ish grid with a few cells per body.
+	const FVector2D Extent = GridBounds.GetSize().ComponentMax(FVector2D(1.0));
+	const double CellArea = (Extent.X * Extent.Y) / FMath::Max(1, (NumBodies - UnboundedBodies.Num()) * TargetCellsPerBody);
+	const double CellSide = FMath::Max(FMath::Sqrt(CellArea), 1.0);
+
+	GridSize.X = FMath::Clamp(FMath::CeilToInt32(Extent.X / CellSide), 1, MaxGridCellsPerAxis);
+	GridSize.Y = FMath::Clamp(FMath::CeilToInt32(Extent.Y / CellSide), 1, MaxGridCellsPerAxis);
+	InvCellSize = FVector2D(GridSize.X / Extent.X, GridSize.Y / Extent.Y);
+
+	const int32 NumCells = GridSize.X * GridSize.Y;
+
+	// Two passes: count the bodies per cell, then fill in the flattened array. Bodies are visited in order, so each cell range stays sorted.
+	// Unbounded bodies cover the whole grid, so they are listed in every cell, in their index order among the bounded ones.
+	TArray<int32> CellCounts;
+	CellCounts.SetNumZeroed(NumCells);
+
+	for (int32 BodyIndex = 0; BodyIndex < NumBodies; ++BodyIndex)
+	{
+		FIntPoint CellMin, CellMax;
+		GetCellRange(BodyBounds[BodyIndex], CellMin, CellMax);
+
+		for (int32 Y = CellMin.Y; Y <= CellMax.Y; ++Y)
+		{
+			for (int32 X = CellMin.X; X <= CellMax.X; ++X)
+			{
+				++CellCounts[Y * GridSize.X + X];
+			}
+		}
+	}
+
+	CellStarts.SetNumUninitialized(NumCells + 1);
+	CellStarts[0] = 0;
+	for (int32 CellIndex = 0; CellIndex < NumCells; ++CellIndex)
+	{
+		CellStarts[CellIndex + 1] = CellStarts[CellIndex] + CellCounts[CellIndex];
+		CellCounts[CellIndex] = CellStarts[CellIndex];
+	}
+
+	CellBodies.SetNumUninitialized(CellStarts[NumCells]);
+
+	for (int32 BodyIndex = 0; BodyIndex < NumBodies; ++BodyIndex)
+	{
+		FIntPoint CellMin, CellMax;
+		GetCellRange(BodyBounds[BodyIndex], CellMin, CellMax);
+
+		for (int32 Y = CellMin.Y; Y <= CellMax.Y; ++Y)
+		{
+			for (int32 X = CellMin.X; X <= CellMax.X; ++X)
+			{
+				CellBodies[CellCounts[Y * GridSize.X + X]++] = BodyIndex;
+			}
+		}
+	}
+}
+
+void FPCGWaterBodyIndex::GetOverlappingBodies(const FBox2D& InBox, TArray<int32>& OutBodies) const
+{
+	OutBodies.Reset();
+
+	if (GridSize.X == 0 || !GridBounds.Intersect(InBox))
+	{
+		OutBodies.Append(UnboundedBodies);
+		return;
+	}
+
+	FIntPoint CellMin, CellMax;
+	GetCellRange(InBox, CellMin, CellMax);
+
+	// Bodies spanning several cells are found several times, hence the sort and dedup at the end
+	for (int32 Y = CellMin.Y; Y <= CellMax.Y; ++Y)
+	{
+		for (int32 X = CellMin.X; X <= CellMax.X; ++X)
+		{
+			const int32 CellIndex = Y * GridSize.X + X;
+			for (int32 BodyOffset = CellStarts[CellIndex]; BodyOffset < CellStarts[CellIndex + 1]; ++BodyOffset)
+			{
+				const int32 BodyIndex = CellBodies[BodyOffset];
+				if (BodyBounds[BodyIndex].Intersect(InBox))
+				{
+					OutBodies.Add(BodyIndex);
+				}
+			}
+		}
+	}
+
+	OutBodies.Sort();
+	OutBodies.SetNum(Algo::Unique(OutBodies));
+}
+
+bool FPCGWaterBodyIndex::HasBodyOverlapping(const FBox2D& InBox) const
+{
+	if (!UnboundedBodies.IsEmpty())
+	{
+		return true;
+	}
+
+	if (GridSize.X == 0 || !GridBounds.Intersect(InBox))
+	{
+		return false;
+	}
+
+	FIntPoint CellMin, CellMax;
+	GetCellRange(InBox, CellMin, CellMax);
+
+	for (int32 Y = CellMin.Y; Y <= CellMax.Y; ++Y)
+	{
+		for (int32 X = CellMin.X; X <= CellMax.X; ++X)
+		{
+			const int32 CellIndex = Y * GridSize.X + X;
+			for (int32 BodyOffset = CellStarts[CellIndex]; BodyOffset < CellStarts[CellIndex + 1]; ++BodyOffset)
+			{
+				if (BodyBounds[CellBodies[BodyOffset]].Intersect(InBox))
+				{
+					return true;
+				}
+			}
+		}
+	}
+
+	return false;
+}
+
+void FPCGWaterBodyIndex::GetCellRange(const FBox2D& InBox, FIntPoint& OutMin, FIntPoint& OutMax) const
+{
+	using namespace UE::PCGWaterInterop::Private;
+
+	const FVector2D Min = (InBox.Min - GridBounds.Min) * InvCellSize;
+	const FVector2D Max = (InBox.Max - GridBounds.Min) * InvCellSize;
+	OutMin = FIntPoint(GetCellCoordinate(Min.X, GridSize.X), GetCellCoordinate(Min.Y, GridSize.Y));
+	OutMax = FIntPoint(GetCellCoordinate(Max.X, GridSize.X), GetCellCoordinate(Max.Y, GridSize.Y));
+}
+
+TConstArrayView<int32> FPCGWaterBodyIndex::GetCellBodies(const FVector2D& InLocation) const
+{
+	if (GridSize.X == 0 || !GridBounds.IsInside(InLocation))
+	{
+		return UnboundedBodies;
+	}
+
+	using namespace UE::PCGWaterInterop::Private;
+
+	const FVector2D Local = (InLocation - GridBounds.Min) * InvCellSize;
+	const int32 X = GetCellCoordinate(Local.X, GridSize.X);
+	const int32 Y = GetCellCoordinate(Local.Y, GridSize.Y);
+	const int32 CellIndex = Y * GridSize.X + X;
+
+	return MakeArrayView(CellBodies.GetData() + CellStarts[CellIndex], CellStarts[CellIndex + 1] - CellStarts[CellIndex]);
+}
@@ -3,50 +3,496 @@
 #include "Data/PCGWaterData.h"
 
 #include "Data/PCGPointData.h"
+#include "Data/PCGWaterBodyIndex.h"
+#include "Data/PCGWaterExclusionVolumes.h"
+#include "Data/PCGWaterRaster.h"
+#include "Data/PCGWaterSnapshot.h"
+#include "Data/PCGWaterWaveKernel.h"
+#include "Helpers/PCGHelpers.h"
+#include "Metadata/PCGMetadataAttributeTpl.h"
+#include "PCGWaterStats.h"
+#include "PCGWaterSubsystem.h"
 #include "WaterBodyActor.h"
+#include "WaterBodyComponent.h"
+#include "WaterBodyExclusionVolume.h"
 
-void UPCGWaterData::Initialize(const TArray<TWeakObjectPtr<AWaterBody>>& InWaterBodies, const FBox& InBounds, bool bInUseMetadata)
+#include "Algo/BinarySearch.h"
+#include "Algo/Count.h"
+#include "Async/ParallelFor.h"
+#include "Misc/MemStack.h"
+
+namespace UE::PCGWaterInterop::Private
 {
-	TArray<TWeakObjectPtr<AWaterBody>> FilteredWaterBodies;
-	for (TWeakObjectPtr<AWaterBody> WaterBody : InWaterBodies)
+	/** Calls InFunc on the bodies that can contain the location, through the index if there is one. Stops and returns true as soon as InFunc returns true. */
+	template<typename FuncType>
+	bool ForEachCandidate(const FPCGWaterBodyIndex* InBodyIndex, int32 InNumBodies, const FVector& InLocation, FuncType&& InFunc)
+	{
+		if (InBodyIndex)
+		{
+			return InBodyIndex->ForEachCandidate(InLocation, InFunc);
+		}
+
+		for (int32 WaterBodyIndex = 0; WaterBodyIndex < InNumBodies; ++WaterBodyIndex)
+		{
+			if (InFunc(WaterBodyIndex))
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	// Number of grid cells sampled per task in CreatePointData.
+	constexpr int32 CreatePointDataChunkSize = 4096;
+
+	/** Row of grid cells sampled by CreatePointData, from MinX to MaxX included. */
+	struct FCellSpan
+	{
+		int32 Y = 0;
+		int32 MinX = 0;
+		int32 MaxX = 0;
+	};
+
+	/**
+	* Gathers the grid cells inside the XY bounds of the bodies, clipped to InBounds, as row spans sorted by row then column without overlaps.
+	* Returns false if a body is unbounded, in which case every cell has to be sampled.
+	*/
+	bool GatherBodyCellSpans(TConstArrayView<FBox> InBodyBounds, const FBox& InBounds, double InSpacing, TArray<FCellSpan>& OutSpans)
+	{
+		OutSpans.Reset();
+
+		for (const FBox& BodyBounds : InBodyBounds)
+		{
+			if (!BodyBounds.IsValid)
+			{
+				return false;
+			}
+
+			const int32 MinX = FMath::CeilToInt32(FMath::Max(BodyBounds.Min.X, InBounds.Min.X) / InSpacing);
+			const int32 MinY = FMath::CeilToInt32(FMath::Max(BodyBounds.Min.Y, InBounds.Min.Y) / InSpacing);
+			const int32 MaxX = FMath::FloorToInt32(FMath::Min(BodyBounds.Max.X, InBounds.Max.X) / InSpacing);
+			const int32 MaxY = FMath::FloorToInt32(FMath::Min(BodyBounds.Max.Y, InBounds.Max.Y) / InSpacing);
+
+			if (MinX > MaxX)
+			{
+				continue;
+			}
+
+			for (int32 Y = MinY; Y <= MaxY; ++Y)
+			{
+				OutSpans.Add({ Y, MinX, MaxX });
+			}
+		}
+
+		OutSpans.Sort([](const FCellSpan& A, const FCellSpan& B) { return (A.Y != B.Y) ? (A.Y < B.Y) : (A.MinX < B.MinX); });
+
+		// Overlapping bodies cover the same cells, merge their spans so these cells are sampled once
+		int32 NumMerged = 0;
+		for (int32 SpanIndex = 0; SpanIndex < OutSpans.Num(); ++SpanIndex)
+		{
+			const FCellSpan Span = OutSpans[SpanIndex];
+			if (NumMerged > 0 && OutSpans[NumMerged - 1].Y == Span.Y && Span.MinX <= OutSpans[NumMerged - 1].MaxX + 1)
+			{
+				OutSpans[NumMerged - 1].MaxX = FMath::Max(OutSpans[NumMerged - 1].MaxX, Span.MaxX);
+			}
+			else
+			{
+				OutSpans[NumMerged++] = Span;
+			}
+		}
+
+		OutSpans.SetNum(NumMerged, /*bAllowShrinking=*/false);
+		return true;
+	}
+
+	/** Records a batch of samples in the water stats. */
+	void RecordSampleStats(int32 InNumLocations, int32 InNumQueries, int32 InNumRasterSamples, int32 InNumHits)
+	{
+		INC_DWORD_STAT_BY(STAT_PCGWater_SampledLocations, InNumLocations);
+		INC_DWORD_STAT_BY(STAT_PCGWater_WaterBodyQueries, InNumQueries);
+		INC_DWORD_STAT_BY(STAT_PCGWater_RasterSamples, InNumRasterSamples);
+		INC_DWORD_STAT_BY(STAT_PCGWater_Hits, InNumHits);
+		INC_DWORD_STAT_BY(STAT_PCGWater_Misses, InNumLocations - InNumHits);
+	}
+
+	void SetSampleFromQuery(const FWaterBodyQueryResult& InQueryResult, int32 InWaterBodyIndex, EWaterBodyQueryFlags InQueryFlags, FPCGWaterSurfaceSample& OutSample)
+	{
+		OutSample.Location = InQueryResult.GetWaterSurfaceLocation();
+		OutSample.Normal = EnumHasAnyFlags(InQueryFlags, EWaterBodyQueryFlags::ComputeNormal) ? InQueryResult.GetWaterSurfaceNormal() : FVector::UpVector;
+		OutSample.ImmersionDepth = InQueryResult.GetImmersionDepth();
+		OutSample.Velocity = EnumHasAnyFlags(InQueryFlags, EWaterBodyQueryFlags::ComputeVelocity) ? InQueryResult.GetVelocity() : FVector::ZeroVector;
+		OutSample.WaterBodyIndex = InWaterBodyIndex;
+	}
+
+	/** Adds the waves evaluated by a kernel to a still water sample. Returns false if a wave trough leaves the location out of the water. */
+	bool AddWaves(const UWaterBodyComponent* InComponent, float InWaterDepth, float InWaveHeight, const FVector* InWaveNormal, FPCGWaterSurfaceSample& InOutSample)
+	{
+		// Waves fade out in shallow water, like in the water body queries
+		const float Attenuation = InComponent->GetWaveAttenuationFactor(InOutSample.Location, InWaterDepth);
+		const float WaveHeight = InWaveHeight * Attenuation;
+		InOutSample.Location.Z += WaveHeight;
+		InOutSample.ImmersionDepth += WaveHeight;
+
+		if (InWaveNormal)
+		{
+			InOutSample.Normal = (InOutSample.Normal + (*InWaveNormal - FVector::UpVector) * Attenuation).GetSafeNormal(UE_SMALL_NUMBER, FVector::UpVector);
+		}
+
+		return InOutSample.ImmersionDepth > 0.0f;
+	}
+
+	FName GetWaterBodyTypeName(EWaterBodyType InType)
+	{
+		static const FName RiverName = TEXT("River");
+		static const FName LakeName = TEXT("Lake");
+		static const FName OceanName = TEXT("Ocean");
+		static const FName TransitionName = TEXT("Transition");
+
+		switch (InType)
+		{
+		case EWaterBodyType::River: return RiverName;
+		case EWaterBodyType::Lake: return LakeName;
+		case EWaterBodyType::Ocean: return OceanName;
+		case EWaterBodyType::Transition: return TransitionName;
+		default: return NAME_None;
+		}
+	}
+
+	/** Typed water attributes of a metadata, looked up (or created) once so values can be written without going through the attribute map. */
+	struct FWaterAttributes
+	{
+		FWaterAttributes(UPCGMetadata* InMetadata, EPCGWaterAttributes InAttributes, bool bInCreateAttributes)
+			: Metadata(InMetadata)
+		{
+			if (!Metadata)
+			{
+				return;
+			}
+
+			if (bInCreateAttributes)
+			{
+				if (EnumHasAnyFlags(InAttributes, EPCGWaterAttributes::WaterBodyType))
+				{
+					WaterBodyType = Metadata->FindOrCreateAttribute<FName>(PCGWaterDataConstants::WaterBodyTypeAttribute, NAME_None, /*bAllowsInterpolation=*/false, /*bOverrideParent=*/false);
+				}
+
+				if (EnumHasAnyFlags(InAttributes, EPCGWaterAttributes::Depth))
+				{
+					Depth = Metadata->FindOrCreateAttribute<float>(PCGWaterDataConstants::DepthAttribute, 0.0f, /*bAllowsInterpolation=*/true, /*bOverrideParent=*/false);
+				}
+
+				if (EnumHasAnyFlags(InAttributes, EPCGWaterAttributes::Velocity))
+				{
+					Velocity = Metadata->FindOrCreateAttribute<FVector>(PCGWaterDataConstants::VelocityAttribute, FVector::ZeroVector, /*bAllowsInterpolation=*/true, /*bOverrideParent=*/false);
+				}
+
+				if (EnumHasAnyFlags(InAttributes, EPCGWaterAttributes::WaterTags))
+				{
+					WaterTags = Metadata->FindOrCreateAttribute<FName>(PCGWaterDataConstants::WaterTagsAttribute, NAME_None, /*bAllowsInterpolation=*/false, /*bOverrideParent=*/false);
+				}
+			}
+			else
+			{
+				// Only write to attributes that already exist, since creating attributes isn't safe while other points are processed in parallel.
+				if (EnumHasAnyFlags(InAttributes, EPCGWaterAttributes::WaterBodyType))
+				{
+					WaterBodyType = Metadata->GetMutableTypedAttribute<FName>(PCGWaterDataConstants::WaterBodyTypeAttribute);
+				}
+
+				if (EnumHasAnyFlags(InAttributes, EPCGWaterAttributes::Depth))
+				{
+					Depth = Metadata->GetMutableTypedAttribute<float>(PCGWaterDataConstants::DepthAttribute);
+				}
+
+				if (EnumHasAnyFlags(InAttributes, EPCGWaterAttributes::Velocity))
+				{
+					Velocity = Metadata->GetMutableTypedAttribute<FVector>(PCGWaterDataConstants::VelocityAttribute);
+				}
+
+				if (EnumHasAnyFlags(InAttributes, EPCGWaterAttributes::WaterTags))
+				{
+					WaterTags = Metadata->GetMutableTypedAttribute<FName>(PCGWaterDataConstants::WaterTagsAttribute);
+				}
+			}
+		}
+
+		bool HasAnyAttribute() const { return WaterBodyType || Depth || Velocity || WaterTags; }
+
+		UPCGMetadata* Metadata = nullptr;
+		FPCGMetadataAttribute<FName>* WaterBodyType = nullptr;
+		FPCGMetadataAttribute<float>* Depth = nullptr;
+		FPCGMetadataAttribute<FVector>* Velocity = nullptr;
+		FPCGMetadataAttribute<FName>* WaterTags = nullptr;
+	};
+
+	void ApplySurfaceSample(const FPCGWaterSurfaceSample& InSample, FPCGPoint& OutPoint)
+	{
+		OutPoint.Transform.SetIdentity();
+		OutPoint.Transform.SetLocation(InSample.Location);
+		OutPoint.Transform.SetRotation(InSample.Normal.ToOrientationQuat());
+		OutPoint.Density = InSample.ImmersionDepth;
+	}
+
+	void ApplyProjectionParams(const FTransform& InTransform, const FPCGProjectionParams& InParams, FPCGPoint& OutPoint)
+	{
+		if (!InParams.bProjectRotations)
+		{
+			OutPoint.Transform.SetRotation(InTransform.GetRotation());
+		}
+		else
+		{
+			// Take landscape transform, but respect initial point yaw (don't spin points around Z axis).
+			FVector RotVector = InTransform.GetRotation().ToRotationVector();
+			RotVector.X = RotVector.Y = 0;
+			OutPoint.Transform.SetRotation(OutPoint.Transform.GetRotation() * FQuat::MakeFromRotationVector(RotVector));
+		}
+
+		if (!InParams.bProjectScales)
+		{
+			OutPoint.Transform.SetScale3D(InTransform.GetScale3D());
+		}
+	}
+
+	void ProjectToSample(const FTransform& InTransform, const FPCGWaterSurfaceSample& InSample, const FPCGProjectionParams& InParams, bool bInHeightOnly, FPCGPoint& OutPoint)
+	{
+		if (bInHeightOnly)
+		{
+			// Only snap to the water height, the input rotation and scale are kept as is
+			OutPoint.Transform = InTransform;
+			OutPoint.Transform.SetLocation(InSample.Location);
+			OutPoint.Density = InSample.ImmersionDepth;
+		}
+		else
+		{
+			ApplySurfaceSample(InSample, OutPoint);
+			ApplyProjectionParams(InTransform, InParams, OutPoint);
+		}
+	}
+
+	/** Point of CreatePointData for the grid cell, seeded from the cell so adjacent bounds generate the same points. */
+	void MakeGridPoint(const FPCGWaterSurfaceSample& InSample, const FIntPoint& InCell, const FVector& InExtents, bool bInHeightOnly, FPCGPoint& OutPoint)
+	{
+		if (bInHeightOnly)
+		{
+			OutPoint.Transform.SetLocation(InSample.Location);
+			OutPoint.Density = InSample.ImmersionDepth;
+		}
+		else
+		{
+			ApplySurfaceSample(InSample, OutPoint);
+		}
+
+		OutPoint.SetExtents(InExtents);
+		OutPoint.Seed = PCGHelpers::ComputeSeed(InCell.X, InCell.Y);
+	}
+
+	/** True if the points of a block can be interpolated from its corners: all dry, or all in the same body with depths within the tolerance. */
+	bool IsUniformBlock(const FPCGWaterSurfaceSample* const (&InCorners)[4], float InDepthTolerance)
 	{
-		if (WaterBody.IsValid())
+		float MinDepth = InCorners[0]->ImmersionDepth;
+		float MaxDepth = InCorners[0]->ImmersionDepth;
+
+		for (const FPCGWaterSurfaceSample* Corner : InCorners)
 		{
-			FilteredWaterBodies.Add(WaterBody);
+			if (Corner->WaterBodyIndex != InCorners[0]->WaterBodyIndex)
+			{
+				return false;
+			}
+
+			MinDepth = FMath::Min(MinDepth, Corner->ImmersionDepth);
+			MaxDepth = FMath::Max(MaxDepth, Corner->ImmersionDepth);
 		}
+
+		return !InCorners[0]->IsInWater() || (MaxDepth - MinDepth) <= InDepthTolerance;
 	}
 
-	for (TWeakObjectPtr<AWaterBody> WaterBody : FilteredWaterBodies)
+	/** Bilinear interpolation of the corners, ordered (0, 0), (1, 0), (0, 1), (1, 1), at the given XY. */
+	FPCGWaterSurfaceSample InterpolateBlockSample(const FPCGWaterSurfaceSample* const (&InCorners)[4], double InU, double InV, const FVector2D& InLocation)
 	{
-		check(WaterBody.IsValid());
-		WaterBodies.Emplace(WaterBody.Get());
+		const float U = static_cast<float>(InU);
+		const float V = static_cast<float>(InV);
+
+		FPCGWaterSurfaceSample Sample;
+		Sample.Location = FVector(InLocation, FMath::BiLerp(InCorners[0]->Location.Z, InCorners[1]->Location.Z, InCorners[2]->Location.Z, InCorners[3]->Location.Z, InU, InV));
+		Sample.Normal = FMath::BiLerp(InCorners[0]->Normal, InCorners[1]->Normal, InCorners[2]->Normal, InCorners[3]->Normal, InU, InV).GetSafeNormal(UE_SMALL_NUMBER, FVector::UpVector);
+		Sample.ImmersionDepth = FMath::BiLerp(InCorners[0]->ImmersionDepth, InCorners[1]->ImmersionDepth, InCorners[2]->ImmersionDepth, InCorners[3]->ImmersionDepth, U, V);
+		Sample.Velocity = FMath::BiLerp(InCorners[0]->Velocity, InCorners[1]->Velocity, InCorners[2]->Velocity, InCorners[3]->Velocity, InU, InV);
+		Sample.WaterBodyIndex = InCorners[0]->WaterBodyIndex;
+
+		return Sample;
 	}
+}
 
-	check(!WaterBodies.IsEmpty());
+void UPCGWaterData::Initialize(const TArray<TWeakObjectPtr<AWaterBody>>& InWaterBodies, const FBox& InBounds, bool bInUseMetadata, EPCGWaterAttributes InAttributes, bool bInApplyExclusionVolumes)
+{
+	InitializeFromEntries(ResolveWaterBodies(InWaterBodies, bInApplyExclusionVolumes), InBounds, bInUseMetadata, InAttributes, bInApplyExclusionVolumes);
+}
 
-	AWaterBody* FirstWaterBody = WaterBodies[0].Get();
-	check(FirstWaterBody);
+void UPCGWaterData::InitializeFromEntries(TArray<FPCGWaterBodyEntry> InEntries, const FBox& InBounds, bool bInUseMetadata, EPCGWaterAttributes InAttributes, bool bInApplyExclusionVolumes)
+{
+	check(!InEntries.IsEmpty());
 
+	WaterBodyEntries = MoveTemp(InEntries);
 	Bounds = InBounds;
 	bUseMetadata = bInUseMetadata;
+	Attributes = InAttributes;
+
+	Transform = WaterBodyEntries[0].Transform;
+
+	WaterBodies.Reset(WaterBodyEntries.Num());
+	TArray<FBox> WaterBodyBounds;
+	WaterBodyBounds.Reserve(WaterBodyEntries.Num());
+
+	for (const FPCGWaterBodyEntry& Entry : WaterBodyEntries)
+	{
+		WaterBodies.Add(Entry.WaterBody);
+		WaterBodyBounds.Add(Entry.Bounds);
+	}
+
+	TSharedPtr<FPCGWaterBodyIndex> NewBodyIndex = MakeShared<FPCGWaterBodyIndex>();
+	NewBodyIndex->Build(WaterBodyBounds);
+	BodyIndex = MoveTemp(NewBodyIndex);
+
+	// Index the exclusion volumes once, queries then reject excluded locations with a grid lookup instead of testing every volume
+	ExclusionVolumes.Reset();
+	if (bInApplyExclusionVolumes)
+	{
+		TSharedPtr<FPCGWaterExclusionVolumes> NewExclusionVolumes = MakeShared<FPCGWaterExclusionVolumes>();
+		NewExclusionVolumes->Build(WaterBodyEntries);
+		if (!NewExclusionVolumes->IsEmpty())
+		{
+			ExclusionVolumes = MoveTemp(NewExclusionVolumes);
+		}
+	}
+
+	// Create the attributes up front, data initialized from this one (ie. projections) inherit them and points only have to write values.
+	const UE::PCGWaterInterop::Private::FWaterAttributes CreatedAttributes(Metadata, GetAttributes(), /*bInCreateAttributes=*/true);
+}
+
+TArray<FPCGWaterBodyEntry> UPCGWaterData::ResolveWaterBodies(TConstArrayView<TWeakObjectPtr<AWaterBody>> InWaterBodies, bool bInResolveExclusionVolumes)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UPCGWaterData::ResolveWaterBodies);
+
+	// Actors and components are edited on the game thread, reading them is only safe while it waits on the work below
+	check(IsInGameThread());
+
+	TArray<FPCGWaterBodyEntry> Entries;
+	Entries.Reserve(InWaterBodies.Num());
 
-	Transform = FirstWaterBody->GetActorTransform();
+	TArray<AWaterBody*> ValidWaterBodies;
+	ValidWaterBodies.Reserve(InWaterBodies.Num());
+
+	// Capture the raw actor state serially, so every body gets its slot in discovery order
+	for (const TWeakObjectPtr<AWaterBody>& WeakWaterBody : InWaterBodies)
+	{
+		AWaterBody* WaterBody = WeakWaterBody.Get();
+		if (!WaterBody)
+		{
+			continue;
+		}
+
+		const UPCGWaterSubsystem* WaterSubsystem = UPCGWaterSubsystem::GetInstance(WaterBody->GetWorld());
+
+		FPCGWaterBodyEntry& Entry = Entries.Emplace_GetRef();
+		Entry.WaterBody = WaterBody;
+		Entry.Revision = WaterSubsystem ? WaterSubsystem->GetWaterBodyRevision(FSoftObjectPath(WaterBody)) : 0;
+		Entry.Component = WaterBody->GetWaterBodyComponent();
+		Entry.Transform = WaterBody->GetActorTransform();
+		Entry.Type = WaterBody->GetWaterBodyType();
+		Entry.ActorTags = WaterBody->Tags;
+
+		ValidWaterBodies.Add(WaterBody);
+	}
 
-	if (bUseMetadata)
+	// Derived per-body state is computed in parallel, each body only writes its own slot so the entries don't depend on the number of threads
+	ParallelFor(Entries.Num(), [&Entries, &ValidWaterBodies, bInResolveExclusionVolumes](int32 EntryIndex)
 	{
-		static const FName WaterBodyTypeMetadataKey = TEXT("WaterBodyType");
-		for (TSoftObjectPtr<AWaterBody> WaterBody : WaterBodies)
+		AWaterBody* WaterBody = ValidWaterBodies[EntryIndex];
+		UWaterBodyComponent* WaterBodyComponent = WaterBody->GetWaterBodyComponent();
+		FPCGWaterBodyEntry& Entry = Entries[EntryIndex];
+
+		Entry.GridBounds = PCGHelpers::GetGridBounds(WaterBody, nullptr);
+
+		// Oceans answer queries well outside of their actor bounds, so they are left unbounded and kept as candidates everywhere.
+		Entry.Bounds = (Entry.Type == EWaterBodyType::Ocean) ? FBox(EForceInit::ForceInit) : PCGHelpers::GetActorBounds(WaterBody);
+
+		if (!Entry.ActorTags.IsEmpty())
+		{
+			TStringBuilder<256> TagsBuilder;
+			TagsBuilder.Join(Entry.ActorTags, TEXT(","));
+			Entry.Tags = FName(TagsBuilder.ToView());
+		}
+
+		if (WaterBodyComponent && WaterBodyComponent->HasWaves())
+		{
+			TSharedPtr<FPCGWaterWaveKernel> WaveKernel = MakeShared<FPCGWaterWaveKernel>();
+			if (WaveKernel->Initialize(WaterBodyComponent))
+			{
+				Entry.WaveKernel = MoveTemp(WaveKernel);
+			}
+		}
+
+		if (WaterBodyComponent && bInResolveExclusionVolumes)
 		{
-			// @todo: enum to name
-			const FName WaterBodyTypeName = NAME_None;
-			if (!Metadata->HasAttribute(WaterBodyTypeMetadataKey))
+			for (const AWaterBodyExclusionVolume* ExclusionVolume : WaterBodyComponent->GetExclusionVolumes())
 			{
-				Metadata->CreateNameAttribute(WaterBodyTypeMetadataKey, NAME_None, false);
+				// An unbounded volume would exclude the body everywhere
+				const FBox VolumeBounds = ExclusionVolume ? PCGHelpers::GetActorBounds(ExclusionVolume) : FBox(EForceInit::ForceInit);
+				if (VolumeBounds.IsValid)
+				{
+					Entry.ExclusionVolumes.Add({ FObjectKey(ExclusionVolume), VolumeBounds });
+				}
 			}
+		}
+	});
+
+	return Entries;
+}
+
+void UPCGWaterData::InitializeFromSnapshot(const UPCGWaterSnapshot* InSnapshot, const FBox& InBounds, bool bInUseMetadata, EPCGWaterAttributes InAttributes)
+{
+	check(InSnapshot && InSnapshot->HasData());
 
-			// @todo: set from WaterBody->GetWaterBodyType()
-		}		
+	Snapshot = InSnapshot;
+	Bounds = InBounds;
+	bUseMetadata = bInUseMetadata;
+	Attributes = InAttributes;
+	Transform = InSnapshot->GetTransform();
+
+	// Entries keep a null component, so only the raster answers and the bodies are never loaded
+	const TConstArrayView<FPCGWaterSnapshotBody> SnapshotBodies = InSnapshot->GetBodies();
+	WaterBodies.Reset(SnapshotBodies.Num());
+	WaterBodyEntries.Reset(SnapshotBodies.Num());
+	TArray<FBox> WaterBodyBounds;
+	WaterBodyBounds.Reserve(SnapshotBodies.Num());
+
+	for (const FPCGWaterSnapshotBody& SnapshotBody : SnapshotBodies)
+	{
+		WaterBodies.Add(SnapshotBody.WaterBody);
+
+		FPCGWaterBodyEntry& Entry = WaterBodyEntries.Emplace_GetRef();
+		Entry.Type = SnapshotBody.Type;
+		Entry.Bounds = SnapshotBody.Bounds;
+
+		if (EnumHasAnyFlags(Attributes, EPCGWaterAttributes::WaterTags) && !SnapshotBody.Tags.IsEmpty())
+		{
+			TStringBuilder<256> TagsBuilder;
+			TagsBuilder.Join(SnapshotBody.Tags, TEXT(","));
+			Entry.Tags = FName(TagsBuilder.ToView());
+		}
+
+		WaterBodyBounds.Add(Entry.Bounds);
 	}
+
+	TSharedPtr<FPCGWaterBodyIndex> NewBodyIndex = MakeShared<FPCGWaterBodyIndex>();
+	NewBodyIndex->Build(WaterBodyBounds);
+	BodyIndex = MoveTemp(NewBodyIndex);
+
+	ExclusionVolumes.Reset();
+	Raster = InSnapshot->GetRaster();
+
+	const UE::PCGWaterInterop::Private::FWaterAttributes CreatedAttributes(Metadata, GetAttributes(), /*bInCreateAttributes=*/true);
 }
 
 FBox UPCGWaterData::GetBounds() const
@@ -87,80 +533,1005 @@ bool UPCGWaterData::ProjectPoint(
 	FPCGPoint& OutPoint,
 	UPCGMetadata* OutMetadata) const
 {
-	EWaterBodyQueryFlags QueryFlags = EWaterBodyQueryFlags::ComputeImmersionDepth | EWaterBodyQueryFlags::IncludeWaves;
-	for (TSoftObjectPtr<AWaterBody> WaterBodyPtr : WaterBodies)
+	FPCGWaterSurfaceSample Sample;
+	if (SampleWaterSurface(InTransform.GetLocation(), Sample))
 	{
-		if (AWaterBody* WaterBody = WaterBodyPtr.Get())
+		UE::PCGWaterInterop::Private::ProjectToSample(InTransform, Sample, InParams, bHeightOnly, OutPoint);
+
+		if (OutMetadata && GetAttributes() != EPCGWaterAttributes::None)
 		{
-			UWaterBodyComponent* WaterBodyComponent = WaterBody->GetWaterBodyComponent();
-			const FWaterBodyQueryResult QueryResult = WaterBodyComponent->QueryWaterInfoClosestToWorldLocation(InTransform.GetLocation(), QueryFlags);
-			if (QueryResult.IsInWater())
-			{
-				OutPoint.Transform.SetIdentity();
-				OutPoint.Transform.SetLocation(QueryResult.GetWaterSurfaceLocation());
-				OutPoint.Transform.SetRotation(QueryResult.GetWaterSurfaceNormal().ToOrientationQuat());
-				OutPoint.Density = QueryResult.GetImmersionDepth();
-				break;
-			}
+			// Single points are projected in parallel, so only existing attributes are written to.
+			WriteAttributes(MakeArrayView(&OutPoint, 1), MakeArrayView(&Sample, 1), OutMetadata, /*bInCreateAttributes=*/false);
 		}
 	}
-
-	if (!InParams.bProjectRotations)
+	else if (bHeightOnly)
 	{
-		OutPoint.Transform.SetRotation(InTransform.GetRotation());
+		OutPoint.Transform = InTransform;
 	}
 	else
 	{
-		// Take landscape transform, but respect initial point yaw (don't spin points around Z axis).
-		FVector RotVector = InTransform.GetRotation().ToRotationVector();
-		RotVector.X = RotVector.Y = 0;
-		OutPoint.Transform.SetRotation(OutPoint.Transform.GetRotation() * FQuat::MakeFromRotationVector(RotVector));
+		UE::PCGWaterInterop::Private::ApplyProjectionParams(InTransform, InParams, OutPoint);
 	}
-	
-	if (!InParams.bProjectScales)
+
+	return true;
+}
+
+int32 UPCGWaterData::ProjectPoints(TArrayView<FPCGPoint> InOutPoints, const FPCGProjectionParams& InParams, UPCGMetadata* OutMetadata, TBitArray<>* InOutProjected) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UPCGWaterData::ProjectPoints);
+
+	check(!InOutProjected || InOutProjected->Num() == InOutPoints.Num());
+
+	FMemMark Mark(FMemStack::Get());
+
+	// Only the points not projected yet are sampled
+	TArray<int32, TMemStackAllocator<>> PointIndices;
+	TArray<FVector, TMemStackAllocator<>> Locations;
+	PointIndices.Reserve(InOutPoints.Num());
+	Locations.Reserve(InOutPoints.Num());
+	for (int32 PointIndex = 0; PointIndex < InOutPoints.Num(); ++PointIndex)
 	{
-		OutPoint.Transform.SetScale3D(InTransform.GetScale3D());
+		if (!InOutProjected || !(*InOutProjected)[PointIndex])
+		{
+			PointIndices.Add(PointIndex);
+			Locations.Add(InOutPoints[PointIndex].Transform.GetLocation());
+		}
 	}
 
-	return true;
+	TArray<FPCGWaterSurfaceSample, TMemStackAllocator<>> LocationSamples;
+	LocationSamples.SetNum(Locations.Num());
+	SampleWaterSurface(Locations, LocationSamples);
+
+	TArray<FPCGWaterSurfaceSample, TMemStackAllocator<>> Samples;
+	Samples.SetNum(InOutPoints.Num());
+
+	int32 NumInWater = 0;
+	for (int32 LocationIndex = 0; LocationIndex < Locations.Num(); ++LocationIndex)
+	{
+		if (LocationSamples[LocationIndex].IsInWater())
+		{
+			const int32 PointIndex = PointIndices[LocationIndex];
+			Samples[PointIndex] = LocationSamples[LocationIndex];
+
+			FPCGPoint& Point = InOutPoints[PointIndex];
+			const FTransform InTransform = Point.Transform;
+			UE::PCGWaterInterop::Private::ProjectToSample(InTransform, Samples[PointIndex], InParams, bHeightOnly, Point);
+			++NumInWater;
+
+			if (InOutProjected)
+			{
+				(*InOutProjected)[PointIndex] = true;
+			}
+		}
+	}
+
+	WriteAttributes(InOutPoints, Samples, OutMetadata, /*bInCreateAttributes=*/true);
+
+	return NumInWater;
 }
 
-UPCGSpatialData* UPCGWaterData::CopyInternal() const
+int32 UPCGWaterData::SamplePoints(TArrayView<FPCGPoint> InOutPoints, TBitArray<>& OutSampled, UPCGMetadata* OutMetadata) const
 {
-	UPCGWaterData* NewWaterData = NewObject<UPCGWaterData>();
+	TRACE_CPUPROFILER_EVENT_SCOPE(UPCGWaterData::SamplePoints);
 
-	CopyBaseSurfaceData(NewWaterData);
+	FMemMark Mark(FMemStack::Get());
 
-	NewWaterData->WaterBodies = WaterBodies;
-	NewWaterData->Bounds = Bounds;
-	NewWaterData->bHeightOnly = bHeightOnly;
-	NewWaterData->bUseMetadata = bUseMetadata;
+	TArray<FVector, TMemStackAllocator<>> Locations;
+	Locations.SetNumUninitialized(InOutPoints.Num());
+	for (int32 PointIndex = 0; PointIndex < InOutPoints.Num(); ++PointIndex)
+	{
+		Locations[PointIndex] = InOutPoints[PointIndex].Transform.GetLocation();
+	}
 
-	return NewWaterData;
+	TArray<FPCGWaterSurfaceSample, TMemStackAllocator<>> Samples;
+	Samples.SetNum(InOutPoints.Num());
+	SampleWaterSurface(Locations, Samples);
+
+	OutSampled.Init(false, InOutPoints.Num());
+
+	int32 NumSampled = 0;
+	const FPCGProjectionParams DefaultParams;
+	for (int32 PointIndex = 0; PointIndex < InOutPoints.Num(); ++PointIndex)
+	{
+		FPCGWaterSurfaceSample& Sample = Samples[PointIndex];
+		if (!Sample.IsInWater())
+		{
+			continue;
+		}
+
+		FPCGPoint& Point = InOutPoints[PointIndex];
+		const FTransform InTransform = Point.Transform;
+		const FBox InBounds = Point.GetLocalBounds();
+
+		// Same validation as SamplePoint, against the point's own bounds
+		const bool bIsSampled = InBounds.IsValid
+			? FMath::PointBoxIntersection(Sample.Location, InBounds.TransformBy(InTransform))
+			: (InTransform.GetLocation() - Sample.Location).SquaredLength() < UE_SMALL_NUMBER;
+
+		if (bIsSampled)
+		{
+			UE::PCGWaterInterop::Private::ProjectToSample(InTransform, Sample, DefaultParams, bHeightOnly, Point);
+			OutSampled[PointIndex] = true;
+			++NumSampled;
+		}
+		else
+		{
+			// Rejected points don't get attributes
+			Samples[PointIndex].WaterBodyIndex = INDEX_NONE;
+		}
+	}
+
+	WriteAttributes(InOutPoints, Samples, OutMetadata, /*bInCreateAttributes=*/true);
+
+	return NumSampled;
 }
 
-const UPCGPointData* UPCGWaterData::CreatePointData(FPCGContext* Context, const FBox& InBounds) const
+void UPCGWaterData::SampleWaterSurface(TConstArrayView<FVector> InLocations, TArrayView<FPCGWaterSurfaceSample> OutSamples) const
 {
-	TRACE_CPUPROFILER_EVENT_SCOPE(UPCGWaterData::CreatePointData);
+	TRACE_CPUPROFILER_EVENT_SCOPE(UPCGWaterData::SampleWaterSurface);
+	SCOPE_CYCLE_COUNTER(STAT_PCGWater_SampleWaterSurface);
 
-	UPCGPointData* Data = NewObject<UPCGPointData>();
-	Data->InitializeFromData(this);
-	TArray<FPCGPoint>& Points = Data->GetMutablePoints();
+	check(InLocations.Num() == OutSamples.Num());
 
-	FBox EffectiveBounds = Bounds;
-	if (InBounds.IsValid)
+	const int32 NumLocations = InLocations.Num();
+	const int32 NumBodies = WaterBodies.Num();
+	const EWaterBodyQueryFlags QueryFlags = GetQueryFlags();
+
+	// Scratch arrays come from the thread's memory stack, batches are sampled by many small executions and parallel chunks.
+	FMemMark Mark(FMemStack::Get());
+
+	// Validate the water body components once for the whole batch
+	TArray<const UWaterBodyComponent*, TInlineAllocator<16>> WaterBodyComponents;
+	WaterBodyComponents.Reserve(NumBodies);
+	for (int32 WaterBodyIndex = 0; WaterBodyIndex < NumBodies; ++WaterBodyIndex)
 	{
-		EffectiveBounds = Bounds.Overlap(InBounds);
+		WaterBodyComponents.Add(GetWaterBodyComponent(WaterBodyIndex));
 	}
 
-	// Early out
-	if (!EffectiveBounds.IsValid)
+	// Gather the candidate bodies of every location, in order, in a flattened array
+	TArray<int32, TMemStackAllocator<>> CandidateStarts;
+	CandidateStarts.SetNumUninitialized(NumLocations + 1);
+	TArray<int32, TMemStackAllocator<>> Candidates;
+	Candidates.Reserve(NumLocations);
+	int32 NumRasterSamples = 0;
+	int32 NumQueries = 0;
+
+	for (int32 LocationIndex = 0; LocationIndex < NumLocations; ++LocationIndex)
 	{
-		return Data;
+		OutSamples[LocationIndex] = FPCGWaterSurfaceSample();
+		CandidateStarts[LocationIndex] = Candidates.Num();
+
+		// Locations covered by the raster are fully answered by it and get no candidates
+		if (Raster.IsValid() && Raster->Contains(InLocations[LocationIndex]))
+		{
+			Raster->Sample(InLocations[LocationIndex], OutSamples[LocationIndex]);
+			++NumRasterSamples;
+			continue;
+		}
+
+		const FVector& Location = InLocations[LocationIndex];
+		UE::PCGWaterInterop::Private::ForEachCandidate(BodyIndex.Get(), NumBodies, Location, [this, &Location, &Candidates, &WaterBodyComponents](int32 WaterBodyIndex)
+		{
+			if (WaterBodyComponents[WaterBodyIndex] && !IsExcluded(Location, WaterBodyIndex))
+			{
+				Candidates.Add(WaterBodyIndex);
+			}
+
+			return false;
+		});
 	}
 
-	UPCGMetadata* OutMetadata = bUseMetadata ? Data->Metadata : nullptr;
+	CandidateStarts[NumLocations] = Candidates.Num();
+
+	// Cursor in Candidates for each location, and the locations that still have a candidate to test
+	TArray<int32, TMemStackAllocator<>> Cursors;
+	Cursors.SetNumUninitialized(NumLocations);
+	TArray<int32, TMemStackAllocator<>> PendingLocations;
+	PendingLocations.Reserve(NumLocations);
+
+	for (int32 LocationIndex = 0; LocationIndex < NumLocations; ++LocationIndex)
+	{
+		Cursors[LocationIndex] = CandidateStarts[LocationIndex];
+		if (CandidateStarts[LocationIndex] < CandidateStarts[LocationIndex + 1])
+		{
+			PendingLocations.Add(LocationIndex);
+		}
+	}
+
+	// Each round tests the next candidate of every pending location. Locations are bucketed per body (counting sort, stable),
+	// so consecutive queries work on the same spline and wave data, and the first body in water wins like in the single point path.
+	TArray<int32, TMemStackAllocator<>> BodyStarts;
+	TArray<int32, TMemStackAllocator<>> BodyWriteOffsets;
+	TArray<int32, TMemStackAllocator<>> SortedLocations;
+
+	// Bodies with a wave kernel are queried for the still water surface, their waves are then evaluated for the whole bucket at once.
+	const bool bUseWaveKernels = bIncludeWaves && (WaterBodyEntries.Num() == NumBodies);
+	EWaterBodyQueryFlags StillWaterQueryFlags = QueryFlags | EWaterBodyQueryFlags::ComputeDepth;
+	EnumRemoveFlags(StillWaterQueryFlags, EWaterBodyQueryFlags::IncludeWaves);
+
+	TArray<int32, TMemStackAllocator<>> WaveLocationIndices;
+	TArray<FVector, TMemStackAllocator<>> WaveLocations;
+	TArray<float, TMemStackAllocator<>> WaterDepths;
+	TArray<float, TMemStackAllocator<>> WaveHeights;
+	TArray<FVector, TMemStackAllocator<>> WaveNormals;
+
+	while (!PendingLocations.IsEmpty())
+	{
+		BodyStarts.SetNumZeroed(NumBodies + 1);
+		for (int32 LocationIndex : PendingLocations)
+		{
+			++BodyStarts[Candidates[Cursors[LocationIndex]] + 1];
+		}
+
+		for (int32 WaterBodyIndex = 0; WaterBodyIndex < NumBodies; ++WaterBodyIndex)
+		{
+			BodyStarts[WaterBodyIndex + 1] += BodyStarts[WaterBodyIndex];
+		}
+
+		BodyWriteOffsets = BodyStarts;
+		SortedLocations.SetNumUninitialized(PendingLocations.Num());
+		for (int32 LocationIndex : PendingLocations)
+		{
+			SortedLocations[BodyWriteOffsets[Candidates[Cursors[LocationIndex]]]++] = LocationIndex;
+		}
+
+		PendingLocations.Reset();
+
+		for (int32 WaterBodyIndex = 0; WaterBodyIndex < NumBodies; ++WaterBodyIndex)
+		{
+			const UWaterBodyComponent* WaterBodyComponent = WaterBodyComponents[WaterBodyIndex];
+			const FPCGWaterWaveKernel* WaveKernel = bUseWaveKernels ? WaterBodyEntries[WaterBodyIndex].WaveKernel.Get() : nullptr;
+
+			if (WaveKernel && BodyStarts[WaterBodyIndex] < BodyStarts[WaterBodyIndex + 1])
+			{
+				WaveLocationIndices.Reset();
+				WaveLocations.Reset();
+				WaterDepths.Reset();
+
+				for (int32 SortedIndex = BodyStarts[WaterBodyIndex]; SortedIndex < BodyStarts[WaterBodyIndex + 1]; ++SortedIndex)
+				{
+					const int32 LocationIndex = SortedLocations[SortedIndex];
+					const FWaterBodyQueryResult QueryResult = WaterBodyComponent->QueryWaterInfoClosestToWorldLocation(InLocations[LocationIndex], StillWaterQueryFlags);
+					++NumQueries;
+
+					if (QueryResult.IsInWater())
+					{
+						UE::PCGWaterInterop::Private::SetSampleFromQuery(QueryResult, WaterBodyIndex, StillWaterQueryFlags, OutSamples[LocationIndex]);
+						WaveLocationIndices.Add(LocationIndex);
+						WaveLocations.Add(OutSamples[LocationIndex].Location);
+						WaterDepths.Add(QueryResult.GetWaterSurfaceDepth());
+					}
+					else if (++Cursors[LocationIndex] < CandidateStarts[LocationIndex + 1])
+					{
+						PendingLocations.Add(LocationIndex);
+					}
+				}
+
+				WaveHeights.SetNumUninitialized(WaveLocations.Num());
+				WaveNormals.SetNumUninitialized(bHeightOnly ? 0 : WaveLocations.Num());
+				WaveKernel->Evaluate(WaveLocations, WaterBodyComponent->GetWaveReferenceTime(), WaveHeights, WaveNormals);
+
+				for (int32 WaveIndex = 0; WaveIndex < WaveLocationIndices.Num(); ++WaveIndex)
+				{
+					const int32 LocationIndex = WaveLocationIndices[WaveIndex];
+					FPCGWaterSurfaceSample& Sample = OutSamples[LocationIndex];
+
+					if (!UE::PCGWaterInterop::Private::AddWaves(WaterBodyComponent, WaterDepths[WaveIndex], WaveHeights[WaveIndex], bHeightOnly ? nullptr : &WaveNormals[WaveIndex], Sample))
+					{
+						Sample = FPCGWaterSurfaceSample();
+
+						if (++Cursors[LocationIndex] < CandidateStarts[LocationIndex + 1])
+						{
+							PendingLocations.Add(LocationIndex);
+						}
+					}
+				}
+
+				continue;
+			}
+
+			for (int32 SortedIndex = BodyStarts[WaterBodyIndex]; SortedIndex < BodyStarts[WaterBodyIndex + 1]; ++SortedIndex)
+			{
+				const int32 LocationIndex = SortedLocations[SortedIndex];
+				const FWaterBodyQueryResult QueryResult = WaterBodyComponent->QueryWaterInfoClosestToWorldLocation(InLocations[LocationIndex], QueryFlags);
+				++NumQueries;
+
+				if (QueryResult.IsInWater())
+				{
+					UE::PCGWaterInterop::Private::SetSampleFromQuery(QueryResult, WaterBodyIndex, QueryFlags, OutSamples[LocationIndex]);
+				}
+				else if (++Cursors[LocationIndex] < CandidateStarts[LocationIndex + 1])
+				{
+					PendingLocations.Add(LocationIndex);
+				}
+			}
+		}
+	}
+
+	const int32 NumHits = Algo::CountIf(OutSamples, [](const FPCGWaterSurfaceSample& Sample) { return Sample.IsInWater(); });
+	UE::PCGWaterInterop::Private::RecordSampleStats(NumLocations, NumQueries, NumRasterSamples, NumHits);
+}
+
+bool UPCGWaterData::SampleWaterSurface(const FVector& InLocation, FPCGWaterSurfaceSample& OutSample) const
+{
+	if (Raster.IsValid() && Raster->Contains(InLocation))
+	{
+		const bool bIsInWater = Raster->Sample(InLocation, OutSample);
+		UE::PCGWaterInterop::Private::RecordSampleStats(1, 0, 1, bIsInWater ? 1 : 0);
+		return bIsInWater;
+	}
+
+	const EWaterBodyQueryFlags QueryFlags = GetQueryFlags();
+
+	// Same wave semantics as the batched queries: bodies with a wave kernel are queried for the still water surface and the kernel adds the waves.
+	const bool bUseWaveKernels = bIncludeWaves && (WaterBodyEntries.Num() == WaterBodies.Num());
+	EWaterBodyQueryFlags StillWaterQueryFlags = QueryFlags | EWaterBodyQueryFlags::ComputeDepth;
+	EnumRemoveFlags(StillWaterQueryFlags, EWaterBodyQueryFlags::IncludeWaves);
+
+	OutSample = FPCGWaterSurfaceSample();
+	int32 NumQueries = 0;
+
+	const bool bIsInWater = UE::PCGWaterInterop::Private::ForEachCandidate(BodyIndex.Get(), WaterBodies.Num(), InLocation, [this, &InLocation, QueryFlags, StillWaterQueryFlags, bUseWaveKernels, &OutSample, &NumQueries](int32 WaterBodyIndex) -> bool
+	{
+		const UWaterBodyComponent* WaterBodyComponent = GetWaterBodyComponent(WaterBodyIndex);
+		const FPCGWaterWaveKernel* WaveKernel = bUseWaveKernels ? WaterBodyEntries[WaterBodyIndex].WaveKernel.Get() : nullptr;
+
+		if (WaterBodyComponent && WaveKernel && !IsExcluded(InLocation, WaterBodyIndex))
+		{
+			++NumQueries;
+			const FWaterBodyQueryResult QueryResult = WaterBodyComponent->QueryWaterInfoClosestToWorldLocation(InLocation, StillWaterQueryFlags);
+			if (!QueryResult.IsInWater())
+			{
+				return false;
+			}
+
+			UE::PCGWaterInterop::Private::SetSampleFromQuery(QueryResult, WaterBodyIndex, StillWaterQueryFlags, OutSample);
+
+			float WaveHeight = 0.0f;
+			FVector WaveNormal = FVector::UpVector;
+			WaveKernel->Evaluate(MakeArrayView(&OutSample.Location, 1), WaterBodyComponent->GetWaveReferenceTime(), MakeArrayView(&WaveHeight, 1), bHeightOnly ? TArrayView<FVector>() : MakeArrayView(&WaveNormal, 1));
+
+			if (UE::PCGWaterInterop::Private::AddWaves(WaterBodyComponent, QueryResult.GetWaterSurfaceDepth(), WaveHeight, bHeightOnly ? nullptr : &WaveNormal, OutSample))
+			{
+				return true;
+			}
+
+			OutSample = FPCGWaterSurfaceSample();
+			return false;
+		}
+
+		if (WaterBodyComponent && !IsExcluded(InLocation, WaterBodyIndex))
+		{
+			++NumQueries;
+			const FWaterBodyQueryResult QueryResult = WaterBodyComponent->QueryWaterInfoClosestToWorldLocation(InLocation, QueryFlags);
+			if (QueryResult.IsInWater())
+			{
+				UE::PCGWaterInterop::Private::SetSampleFromQuery(QueryResult, WaterBodyIndex, QueryFlags, OutSample);
+				return true;
+			}
+		}
+
+		return false;
+	});
+
+	UE::PCGWaterInterop::Private::RecordSampleStats(1, NumQueries, 0, bIsInWater ? 1 : 0);
+
+	return bIsInWater;
+}
+
+double UPCGWaterData::GetRasterTexelSize() const
+{
+	return Raster.IsValid() ? Raster->GetTexelSize() : 0.0;
+}
+
+void UPCGWaterData::BuildRaster(double InTexelSize, int64 InMemoryBudget)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UPCGWaterData::BuildRaster);
+
+	// Bake from the water bodies, not from a previous raster
+	Raster.Reset();
+
+	TSharedPtr<FPCGWaterRaster> NewRaster = MakeShared<FPCGWaterRaster>();
+	const bool bBakeVelocity = EnumHasAnyFlags(GetQueryFlags(), EWaterBodyQueryFlags::ComputeVelocity);
+	NewRaster->Build(Bounds, InTexelSize, InMemoryBudget, bBakeVelocity,
+		[this](TConstArrayView<FVector> InLocations, TArrayView<FPCGWaterSurfaceSample> OutSamples)
+		{
+			SampleWaterSurface(InLocations, OutSamples);
+		},
+		[this](const FBox2D& InTileBounds)
+		{
+			return !BodyIndex.IsValid() || BodyIndex->HasBodyOverlapping(InTileBounds);
+		});
+
+	Raster = MoveTemp(NewRaster);
+}
+
+const UWaterBodyComponent* UPCGWaterData::GetWaterBodyComponent(int32 InWaterBodyIndex) const
+{
+	if (WaterBodyEntries.Num() == WaterBodies.Num())
+	{
+		return WaterBodyEntries[InWaterBodyIndex].Component.Get();
+	}
+
+	// Not initialized from actors (ie. loaded), go through the soft references
+	const AWaterBody* WaterBody = WaterBodies[InWaterBodyIndex].Get();
+	return WaterBody ? WaterBody->GetWaterBodyComponent() : nullptr;
+}
+
+bool UPCGWaterData::IsExcluded(const FVector& InLocation, int32 InWaterBodyIndex) const
+{
+	return ExclusionVolumes.IsValid() && ExclusionVolumes->IsExcluded(InLocation, InWaterBodyIndex);
+}
+
+void UPCGWaterData::SetQueryMode(bool bInHeightOnly, bool bInIncludeWaves)
+{
+	bHeightOnly = bInHeightOnly;
+	bIncludeWaves = bInIncludeWaves;
+}
+
+EWaterBodyQueryFlags UPCGWaterData::GetQueryFlags() const
+{
+	// Immersion depth is always needed, it tells whether the location is in water.
+	EWaterBodyQueryFlags QueryFlags = EWaterBodyQueryFlags::ComputeImmersionDepth;
+
+	if (!bHeightOnly)
+	{
+		QueryFlags |= EWaterBodyQueryFlags::ComputeNormal;
+	}
+
+	if (bIncludeWaves)
+	{
+		QueryFlags |= EWaterBodyQueryFlags::IncludeWaves;
+	}
+
+	if (EnumHasAnyFlags(GetAttributes(), EPCGWaterAttributes::Velocity))
+	{
+		QueryFlags |= EWaterBodyQueryFlags::ComputeVelocity;
+	}
+
+	return QueryFlags;
+}
+
+void UPCGWaterData::WriteAttributes(TArrayView<FPCGPoint> InOutPoints, TConstArrayView<FPCGWaterSurfaceSample> InSamples, UPCGMetadata* OutMetadata, bool bInCreateAttributes) const
+{
+	check(InOutPoints.Num() == InSamples.Num());
+
+	if (!OutMetadata || GetAttributes() == EPCGWaterAttributes::None)
+	{
+		return;
+	}
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(UPCGWaterData::WriteAttributes);
+
+	const UE::PCGWaterInterop::Private::FWaterAttributes WaterAttributes(OutMetadata, GetAttributes(), bInCreateAttributes);
+	if (!WaterAttributes.HasAnyAttribute())
+	{
+		return;
+	}
+
+	// Scratch arrays come from the thread's memory stack, single point projections and samples write their attributes through here too.
+	FMemMark Mark(FMemStack::Get());
+
+	// Points that don't have an entry of their own in this metadata get one, all allocated in a single call.
+	const int64 ParentKeyCount = OutMetadata->GetItemKeyCountForParent();
+	TArray<int32, TMemStackAllocator<>> PointIndices;
+	PointIndices.Reserve(InOutPoints.Num());
+	TArray<PCGMetadataEntryKey*, TMemStackAllocator<>> NewEntryKeys;
+	NewEntryKeys.Reserve(InOutPoints.Num());
+
+	for (int32 PointIndex = 0; PointIndex < InOutPoints.Num(); ++PointIndex)
+	{
+		if (InSamples[PointIndex].IsInWater())
+		{
+			PointIndices.Add(PointIndex);
+
+			PCGMetadataEntryKey& EntryKey = InOutPoints[PointIndex].MetadataEntry;
+			if (EntryKey == PCGInvalidEntryKey || EntryKey < ParentKeyCount)
+			{
+				NewEntryKeys.Add(&EntryKey);
+			}
+		}
+	}
+
+	if (PointIndices.IsEmpty())
+	{
+		return;
+	}
+
+	OutMetadata->AddEntriesInPlace(NewEntryKeys);
+
+	TArray<PCGMetadataEntryKey, TMemStackAllocator<>> EntryKeys;
+	EntryKeys.SetNumUninitialized(PointIndices.Num());
+	for (int32 Index = 0; Index < PointIndices.Num(); ++Index)
+	{
+		EntryKeys[Index] = InOutPoints[PointIndices[Index]].MetadataEntry;
+	}
+
+	// Values are written attribute by attribute, in bulk. Loaded data has no entries, its body types and tags aren't known.
+	const bool bHasEntries = (WaterBodyEntries.Num() == WaterBodies.Num());
+
+	if (WaterAttributes.WaterBodyType && bHasEntries)
+	{
+		TArray<FName, TMemStackAllocator<>> Values;
+		Values.SetNumUninitialized(PointIndices.Num());
+		for (int32 Index = 0; Index < PointIndices.Num(); ++Index)
+		{
+			Values[Index] = UE::PCGWaterInterop::Private::GetWaterBodyTypeName(WaterBodyEntries[InSamples[PointIndices[Index]].WaterBodyIndex].Type);
+		}
+
+		WaterAttributes.WaterBodyType->SetValues(EntryKeys, Values);
+	}
+
+	if (WaterAttributes.Depth)
+	{
+		TArray<float, TMemStackAllocator<>> Values;
+		Values.SetNumUninitialized(PointIndices.Num());
+		for (int32 Index = 0; Index < PointIndices.Num(); ++Index)
+		{
+			Values[Index] = InSamples[PointIndices[Index]].ImmersionDepth;
+		}
+
+		WaterAttributes.Depth->SetValues(EntryKeys, Values);
+	}
+
+	if (WaterAttributes.Velocity)
+	{
+		TArray<FVector, TMemStackAllocator<>> Values;
+		Values.SetNumUninitialized(PointIndices.Num());
+		for (int32 Index = 0; Index < PointIndices.Num(); ++Index)
+		{
+			Values[Index] = InSamples[PointIndices[Index]].Velocity;
+		}
+
+		WaterAttributes.Velocity->SetValues(EntryKeys, Values);
+	}
+
+	if (WaterAttributes.WaterTags && bHasEntries)
+	{
+		TArray<FName, TMemStackAllocator<>> Values;
+		Values.SetNumUninitialized(PointIndices.Num());
+		for (int32 Index = 0; Index < PointIndices.Num(); ++Index)
+		{
+			Values[Index] = WaterBodyEntries[InSamples[PointIndices[Index]].WaterBodyIndex].Tags;
+		}
+
+		WaterAttributes.WaterTags->SetValues(EntryKeys, Values);
+	}
+}
+
+void UPCGWaterData::SampleGridAdaptive(const FIntPoint& InCellMin, const FIntPoint& InCellMax, double InSpacing, double InSampleZ, TFunctionRef<bool(const FIntPoint&, const FIntPoint&)> InIsBlockCulled, TArray<FIntPoint>& OutCells, TArray<FPCGWaterSurfaceSample>& OutSamples) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UPCGWaterData::SampleGridAdaptive);
+
+	using namespace UE::PCGWaterInterop::Private;
+
+	OutCells.Reset();
+	OutSamples.Reset();
+
+	// Blocks are given by their min cell, all the blocks of a level have the same size. Corners are shared between blocks and levels, each is sampled once.
+	int32 BlockSize = 1 << FMath::Clamp(AdaptiveSamplingLevels, 0, 8);
+
+	auto IsCulled = [&InCellMax, &InIsBlockCulled](const FIntPoint& InBlock, int32 InBlockSize)
+	{
+		return InIsBlockCulled(InBlock, FIntPoint(FMath::Min(InBlock.X + InBlockSize - 1, InCellMax.X), FMath::Min(InBlock.Y + InBlockSize - 1, InCellMax.Y)));
+	};
+
+	TArray<FIntPoint> Blocks;
+	for (int32 BlockY = InCellMin.Y; BlockY <= InCellMax.Y; BlockY += BlockSize)
+	{
+		for (int32 BlockX = InCellMin.X; BlockX <= InCellMax.X; BlockX += BlockSize)
+		{
+			if (!IsCulled(FIntPoint(BlockX, BlockY), BlockSize))
+			{
+				Blocks.Emplace(BlockX, BlockY);
+			}
+		}
+	}
+
+	TMap<FIntPoint, int32> CornerIndices;
+	TArray<FVector> CornerLocations;
+	TArray<FPCGWaterSurfaceSample> CornerSamples;
+	TArray<FIntPoint> NextBlocks;
+
+	while (!Blocks.IsEmpty())
+	{
+		// Sample the corners of this level that previous levels didn't, in batches.
+		const int32 FirstNewCorner = CornerLocations.Num();
+		for (const FIntPoint& Block : Blocks)
+		{
+			for (const FIntPoint& Corner : { Block, Block + FIntPoint(BlockSize, 0), Block + FIntPoint(0, BlockSize), Block + FIntPoint(BlockSize, BlockSize) })
+			{
+				if (!CornerIndices.Contains(Corner))
+				{
+					CornerIndices.Add(Corner, CornerLocations.Num());
+					CornerLocations.Emplace(Corner.X * InSpacing, Corner.Y * InSpacing, InSampleZ);
+				}
+			}
+		}
+
+		const int32 NumNewCorners = CornerLocations.Num() - FirstNewCorner;
+		CornerSamples.SetNum(CornerLocations.Num());
+
+		ParallelFor(FMath::DivideAndRoundUp(NumNewCorners, CreatePointDataChunkSize), [this, &CornerLocations, &CornerSamples, FirstNewCorner, NumNewCorners](int32 ChunkIndex)
+		{
+			const int32 StartIndex = FirstNewCorner + ChunkIndex * CreatePointDataChunkSize;
+			const int32 NumChunkCorners = FMath::Min(CreatePointDataChunkSize, FirstNewCorner + NumNewCorners - StartIndex);
+			SampleWaterSurface(MakeArrayView(CornerLocations.GetData() + StartIndex, NumChunkCorners), MakeArrayView(CornerSamples.GetData() + StartIndex, NumChunkCorners));
+		});
+
+		NextBlocks.Reset();
+
+		for (const FIntPoint& Block : Blocks)
+		{
+			const FPCGWaterSurfaceSample* const Corners[4] =
+			{
+				&CornerSamples[CornerIndices[Block]],
+				&CornerSamples[CornerIndices[Block + FIntPoint(BlockSize, 0)]],
+				&CornerSamples[CornerIndices[Block + FIntPoint(0, BlockSize)]],
+				&CornerSamples[CornerIndices[Block + FIntPoint(BlockSize, BlockSize)]]
+			};
+
+			// A block of a single cell is its min corner
+			if (BlockSize == 1)
+			{
+				if (Corners[0]->IsInWater())
+				{
+					OutCells.Add(Block);
+					OutSamples.Add(*Corners[0]);
+				}
+
+				continue;
+			}
+
+			if (!IsUniformBlock(Corners, AdaptiveDepthTolerance))
+			{
+				const int32 HalfSize = BlockSize / 2;
+				for (const FIntPoint& Child : { Block, Block + FIntPoint(HalfSize, 0), Block + FIntPoint(0, HalfSize), Block + FIntPoint(HalfSize, HalfSize) })
+				{
+					if (Child.X <= InCellMax.X && Child.Y <= InCellMax.Y && !IsCulled(Child, HalfSize))
+					{
+						NextBlocks.Add(Child);
+					}
+				}
+
+				continue;
+			}
+
+			if (!Corners[0]->IsInWater())
+			{
+				continue;
+			}
+
+			const FIntPoint BlockMax(FMath::Min(Block.X + BlockSize - 1, InCellMax.X), FMath::Min(Block.Y + BlockSize - 1, InCellMax.Y));
+			for (int32 CellY = Block.Y; CellY <= BlockMax.Y; ++CellY)
+			{
+				for (int32 CellX = Block.X; CellX <= BlockMax.X; ++CellX)
+				{
+					const double U = static_cast<double>(CellX - Block.X) / BlockSize;
+					const double V = static_cast<double>(CellY - Block.Y) / BlockSize;
+
+					OutCells.Emplace(CellX, CellY);
+					OutSamples.Add(InterpolateBlockSample(Corners, U, V, FVector2D(CellX * InSpacing, CellY * InSpacing)));
+				}
+			}
+		}
+
+		Swap(Blocks, NextBlocks);
+		BlockSize /= 2;
+	}
+
+	// Same order as uniform sampling
+	TArray<int32> Order;
+	Order.SetNumUninitialized(OutCells.Num());
+	for (int32 Index = 0; Index < Order.Num(); ++Index)
+	{
+		Order[Index] = Index;
+	}
+
+	Order.Sort([&OutCells](int32 A, int32 B) { return (OutCells[A].Y != OutCells[B].Y) ? (OutCells[A].Y < OutCells[B].Y) : (OutCells[A].X < OutCells[B].X); });
+
+	TArray<FIntPoint> SortedCells;
+	TArray<FPCGWaterSurfaceSample> SortedSamples;
+	SortedCells.Reserve(Order.Num());
+	SortedSamples.Reserve(Order.Num());
+	for (int32 Index : Order)
+	{
+		SortedCells.Add(OutCells[Index]);
+		SortedSamples.Add(OutSamples[Index]);
+	}
+
+	OutCells = MoveTemp(SortedCells);
+	OutSamples = MoveTemp(SortedSamples);
+}
+
+UPCGSpatialData* UPCGWaterData::CopyInternal() const
+{
+	UPCGWaterData* NewWaterData = NewObject<UPCGWaterData>();
+
+	CopyBaseSurfaceData(NewWaterData);
+
+	NewWaterData->WaterBodies = WaterBodies;
+	NewWaterData->Bounds = Bounds;
+	NewWaterData->bHeightOnly = bHeightOnly;
+	NewWaterData->bIncludeWaves = bIncludeWaves;
+	NewWaterData->bUseMetadata = bUseMetadata;
+	NewWaterData->Attributes = Attributes;
+	NewWaterData->PointSpacing = PointSpacing;
+	NewWaterData->AdaptiveSamplingLevels = AdaptiveSamplingLevels;
+	NewWaterData->AdaptiveDepthTolerance = AdaptiveDepthTolerance;
+	NewWaterData->WaterBodyEntries = WaterBodyEntries;
+	NewWaterData->Snapshot = Snapshot;
+	NewWaterData->BodyIndex = BodyIndex;
+	NewWaterData->ExclusionVolumes = ExclusionVolumes;
+	NewWaterData->Raster = Raster;
+
+	return NewWaterData;
+}
+
+const UPCGPointData* UPCGWaterData::CreatePointData(FPCGContext* Context, const FBox& InBounds) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UPCGWaterData::CreatePointData);
+	SCOPE_CYCLE_COUNTER(STAT_PCGWater_CreatePointData);
+
+	UPCGPointData* Data = NewObject<UPCGPointData>();
+	Data->InitializeFromData(this);
+	TArray<FPCGPoint>& Points = Data->GetMutablePoints();
+
+	FBox EffectiveBounds = Bounds;
+	if (InBounds.IsValid)
+	{
+		EffectiveBounds = Bounds.Overlap(InBounds);
+	}
+
+	// Early out
+	if (!EffectiveBounds.IsValid)
+	{
+		return Data;
+	}
+
+	UPCGMetadata* OutMetadata = bUseMetadata ? Data->Metadata : nullptr;
+
+	// The grid is aligned on world space multiples of the spacing, so that adjacent bounds (ie. partition cells) sample the same locations and seeds.
+	const double Spacing = FMath::Max(static_cast<double>(PointSpacing), 1.0);
+	const FIntPoint CellMin(FMath::CeilToInt32(EffectiveBounds.Min.X / Spacing), FMath::CeilToInt32(EffectiveBounds.Min.Y / Spacing));
+	const FIntPoint CellMax(FMath::FloorToInt32(EffectiveBounds.Max.X / Spacing), FMath::FloorToInt32(EffectiveBounds.Max.Y / Spacing));
+	const FIntPoint CellCount = CellMax - CellMin + FIntPoint(1, 1);
+
+	if (CellCount.X <= 0 || CellCount.Y <= 0)
+	{
+		return Data;
+	}
+
+	// Sample from the bottom of the bounds, since only locations under the water surface are reported as in water.
+	const double SampleZ = EffectiveBounds.Min.Z;
+	const FVector PointExtents(0.5 * Spacing);
+	const bool bWriteAttributes = (OutMetadata && GetAttributes() != EPCGWaterAttributes::None);
+
+	// Only the cells inside the bounds of a body overlapping the effective bounds are sampled, so the land between bodies costs nothing.
+	// Unbounded bodies (ie. oceans) cover the whole grid. Adaptive sampling skips the blocks outside of these cells the same way.
+	TArray<UE::PCGWaterInterop::Private::FCellSpan> CellSpans;
+	bool bHasBodySpans = false;
+
+	if (WaterBodyEntries.Num() == WaterBodies.Num())
+	{
+		TArray<FBox, TInlineAllocator<16>> OverlappingBodyBounds;
+
+		if (BodyIndex.IsValid())
+		{
+			TArray<int32> OverlappingBodies;
+			BodyIndex->GetOverlappingBodies(FBox2D(FVector2D(EffectiveBounds.Min), FVector2D(EffectiveBounds.Max)), OverlappingBodies);
+
+			for (int32 WaterBodyIndex : OverlappingBodies)
+			{
+				OverlappingBodyBounds.Add(WaterBodyEntries[WaterBodyIndex].Bounds);
+			}
+		}
+		else
+		{
+			for (const FPCGWaterBodyEntry& Entry : WaterBodyEntries)
+			{
+				OverlappingBodyBounds.Add(Entry.Bounds);
+			}
+		}
+
+		bHasBodySpans = UE::PCGWaterInterop::Private::GatherBodyCellSpans(OverlappingBodyBounds, EffectiveBounds, Spacing, CellSpans);
+	}
+
+	if (!bHasBodySpans)
+	{
+		CellSpans.Reset(CellCount.Y);
+		for (int32 CellY = CellMin.Y; CellY <= CellMax.Y; ++CellY)
+		{
+			CellSpans.Add({ CellY, CellMin.X, CellMax.X });
+		}
+	}
+
+	if (AdaptiveSamplingLevels > 0)
+	{
+		const int64 NumGridCells = static_cast<int64>(CellCount.X) * CellCount.Y;
+		if (NumGridCells > MAX_int32)
+		{
+			UE_LOG(LogPCG, Warning, TEXT("UPCGWaterData::CreatePointData: too many points to sample (%lld), increase the point spacing."), NumGridCells);
+			return Data;
+		}
+
+		TArray<FIntPoint> Cells;
+		TArray<FPCGWaterSurfaceSample> CellSamples;
+		auto IsBlockCulled = [&CellSpans](const FIntPoint& InBlockMin, const FIntPoint& InBlockMax)
+		{
+			// Spans are sorted by row then column
+			for (int32 SpanIndex = Algo::LowerBoundBy(CellSpans, InBlockMin.Y, &UE::PCGWaterInterop::Private::FCellSpan::Y); SpanIndex < CellSpans.Num() && CellSpans[SpanIndex].Y <= InBlockMax.Y; ++SpanIndex)
+			{
+				if (CellSpans[SpanIndex].MinX <= InBlockMax.X && CellSpans[SpanIndex].MaxX >= InBlockMin.X)
+				{
+					return false;
+				}
+			}
+
+			return true;
+		};
+
+		SampleGridAdaptive(CellMin, CellMax, Spacing, SampleZ, IsBlockCulled, Cells, CellSamples);
+
+		TArray<FPCGWaterSurfaceSample> Samples;
+		Points.Reserve(Cells.Num());
+		Samples.Reserve(bWriteAttributes ? Cells.Num() : 0);
+
+		for (int32 CellIndex = 0; CellIndex < Cells.Num(); ++CellIndex)
+		{
+			const FPCGWaterSurfaceSample& Sample = CellSamples[CellIndex];
+			if (!FMath::PointBoxIntersection(Sample.Location, EffectiveBounds))
+			{
+				continue;
+			}
+
+			UE::PCGWaterInterop::Private::MakeGridPoint(Sample, Cells[CellIndex], PointExtents, bHeightOnly, Points.Emplace_GetRef());
+
+			if (bWriteAttributes)
+			{
+				Samples.Add(Sample);
+			}
+		}
+
+		if (bWriteAttributes)
+		{
+			WriteAttributes(Points, Samples, OutMetadata, /*bInCreateAttributes=*/true);
+		}
+
+		INC_DWORD_STAT_BY(STAT_PCGWater_PointsProduced, Points.Num());
+		return Data;
+	}
+
+	int64 NumCells = 0;
+	for (const UE::PCGWaterInterop::Private::FCellSpan& Span : CellSpans)
+	{
+		NumCells += Span.MaxX - Span.MinX + 1;
+	}
+
+	if (NumCells > MAX_int32)
+	{
+		UE_LOG(LogPCG, Warning, TEXT("UPCGWaterData::CreatePointData: too many points to sample (%lld), increase the point spacing."), NumCells);
+		return Data;
+	}
+
+	// First cell index of every span, in the order the cells are sampled
+	TArray<int32> SpanStarts;
+	SpanStarts.SetNumUninitialized(CellSpans.Num() + 1);
+	SpanStarts[0] = 0;
+	for (int32 SpanIndex = 0; SpanIndex < CellSpans.Num(); ++SpanIndex)
+	{
+		SpanStarts[SpanIndex + 1] = SpanStarts[SpanIndex] + CellSpans[SpanIndex].MaxX - CellSpans[SpanIndex].MinX + 1;
+	}
+
+	// Cells are sampled in chunks, whose points are then appended in order so the output doesn't depend on scheduling.
+	const int32 NumChunks = FMath::DivideAndRoundUp(static_cast<int32>(NumCells), UE::PCGWaterInterop::Private::CreatePointDataChunkSize);
+
+	TArray<TArray<FPCGPoint>> ChunkPoints;
+	ChunkPoints.SetNum(NumChunks);
+	TArray<TArray<FPCGWaterSurfaceSample>> ChunkSamples;
+	ChunkSamples.SetNum(bWriteAttributes ? NumChunks : 0);
+
+	ParallelFor(NumChunks, [this, &ChunkPoints, &ChunkSamples, bWriteAttributes, NumCells, &EffectiveBounds, &CellSpans, &SpanStarts, Spacing, SampleZ, &PointExtents](int32 ChunkIndex)
+	{
+		const int32 StartIndex = ChunkIndex * UE::PCGWaterInterop::Private::CreatePointDataChunkSize;
+		const int32 EndIndex = FMath::Min(StartIndex + UE::PCGWaterInterop::Private::CreatePointDataChunkSize, static_cast<int32>(NumCells));
+
+		FMemMark Mark(FMemStack::Get());
+
+		TArray<FIntPoint, TMemStackAllocator<>> Cells;
+		Cells.SetNumUninitialized(EndIndex - StartIndex);
+
+		int32 SpanIndex = Algo::UpperBound(SpanStarts, StartIndex) - 1;
+		for (int32 Index = StartIndex; Index < EndIndex; ++Index)
+		{
+			while (Index >= SpanStarts[SpanIndex + 1])
+			{
+				++SpanIndex;
+			}
+
+			Cells[Index - StartIndex] = FIntPoint(CellSpans[SpanIndex].MinX + Index - SpanStarts[SpanIndex], CellSpans[SpanIndex].Y);
+		}
+
+		// The chunk is queried as one batch, so its waves are evaluated with the wave kernels.
+		TArray<FVector, TMemStackAllocator<>> SampleLocations;
+		SampleLocations.SetNumUninitialized(Cells.Num());
+		for (int32 CellIndex = 0; CellIndex < Cells.Num(); ++CellIndex)
+		{
+			SampleLocations[CellIndex] = FVector(Cells[CellIndex].X * Spacing, Cells[CellIndex].Y * Spacing, SampleZ);
+		}
+
+		TArray<FPCGWaterSurfaceSample, TMemStackAllocator<>> Samples;
+		Samples.SetNum(SampleLocations.Num());
+		SampleWaterSurface(SampleLocations, Samples);
+
+		// The outputs are allocated once, for all the samples in water
+		const int32 NumInWater = Algo::CountIf(Samples, [](const FPCGWaterSurfaceSample& Sample) { return Sample.IsInWater(); });
+		ChunkPoints[ChunkIndex].Reserve(NumInWater);
+		if (bWriteAttributes)
+		{
+			ChunkSamples[ChunkIndex].Reserve(NumInWater);
+		}
+
+		for (int32 CellIndex = 0; CellIndex < Cells.Num(); ++CellIndex)
+		{
+			const int32 CellX = Cells[CellIndex].X;
+			const int32 CellY = Cells[CellIndex].Y;
+
+			const FPCGWaterSurfaceSample& Sample = Samples[CellIndex];
+			if (!Sample.IsInWater() || !FMath::PointBoxIntersection(Sample.Location, EffectiveBounds))
+			{
+				continue;
+			}
+
+			UE::PCGWaterInterop::Private::MakeGridPoint(Sample, FIntPoint(CellX, CellY), PointExtents, bHeightOnly, ChunkPoints[ChunkIndex].Emplace_GetRef());
+
+			if (bWriteAttributes)
+			{
+				ChunkSamples[ChunkIndex].Add(Sample);
+			}
+		}
+	});
+
+	// A single chunk, the common case for partition cells, is moved as is rather than copied
+	if (NumChunks == 1)
+	{
+		Points = MoveTemp(ChunkPoints[0]);
+	}
+	else
+	{
+		int32 NumPoints = 0;
+		for (const TArray<FPCGPoint>& Chunk : ChunkPoints)
+		{
+			NumPoints += Chunk.Num();
+		}
+
+		Points.Reserve(NumPoints);
+		for (TArray<FPCGPoint>& Chunk : ChunkPoints)
+		{
+			Points.Append(MoveTemp(Chunk));
+		}
+	}
+
+	if (bWriteAttributes)
+	{
+		TArray<FPCGWaterSurfaceSample> Samples;
+		if (NumChunks == 1)
+		{
+			Samples = MoveTemp(ChunkSamples[0]);
+		}
+		else
+		{
+			Samples.Reserve(Points.Num());
+			for (TArray<FPCGWaterSurfaceSample>& Chunk : ChunkSamples)
+			{
+				Samples.Append(MoveTemp(Chunk));
+			}
+		}
+
+		WriteAttributes(Points, Samples, OutMetadata, /*bInCreateAttributes=*/true);
+	}
 
+	INC_DWORD_STAT_BY(STAT_PCGWater_PointsProduced, Points.Num());
 
 	return Data;
 }
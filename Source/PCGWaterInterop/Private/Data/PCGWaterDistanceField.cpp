@@ -0,0 +1,275 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Data/PCGWaterDistanceField.h"
+
+#include "Data/PCGWaterData.h"
+#include "Data/PCGWaterSnapshot.h"
+#include "PCGModule.h"
+
+#include "Async/ParallelFor.h"
+
+namespace UE::PCGWaterInterop::Private
+{
+	// Bytes per texel while building: the distances, the squared distances to land and the in-water mask.
+	constexpr int64 DistanceFieldBuildBytesPerTexel = sizeof(float) * 2 + sizeof(bool);
+
+	/**
+	* Exact 1D squared distance transform of sampled functions (Felzenszwalb & Huttenlocher), in place.
+	* Sites are the finite values, the others are left out of the lower envelope so infinities never enter the arithmetic.
+	*/
+	void SquaredDistanceTransform1D(TArrayView<float> InOutValues, TArray<int32>& Sites, TArray<double>& Boundaries, TArray<float>& Costs)
+	{
+		const int32 Num = InOutValues.Num();
+		Costs.Reset(Num);
+		Costs.Append(InOutValues.GetData(), Num);
+		Sites.SetNumUninitialized(Num);
+		Boundaries.SetNumUninitialized(Num + 1);
+
+		int32 NumSites = 0;
+		for (int32 Index = 0; Index < Num; ++Index)
+		{
+			if (Costs[Index] == TNumericLimits<float>::Max())
+			{
+				continue;
+			}
+
+			const double Cost = static_cast<double>(Costs[Index]) + static_cast<double>(Index) * Index;
+			double Intersection = -TNumericLimits<double>::Max();
+
+			while (NumSites > 0)
+			{
+				const int32 Site = Sites[NumSites - 1];
+				Intersection = (Cost - (static_cast<double>(Costs[Site]) + static_cast<double>(Site) * Site)) / (2.0 * (Index - Site));
+				if (Intersection > Boundaries[NumSites - 1])
+				{
+					break;
+				}
+
+				--NumSites;
+				Intersection = -TNumericLimits<double>::Max();
+			}
+
+			Sites[NumSites] = Index;
+			Boundaries[NumSites] = Intersection;
+			Boundaries[NumSites + 1] = TNumericLimits<double>::Max();
+			++NumSites;
+		}
+
+		if (NumSites == 0)
+		{
+			return;
+		}
+
+		int32 SiteIndex = 0;
+		for (int32 Index = 0; Index < Num; ++Index)
+		{
+			while (SiteIndex + 1 < NumSites && Boundaries[SiteIndex + 1] < Index)
+			{
+				++SiteIndex;
+			}
+
+			const int32 Site = Sites[SiteIndex];
+			InOutValues[Index] = static_cast<float>(static_cast<double>(Index - Site) * (Index - Site) + Costs[Site]);
+		}
+	}
+
+	/** Squared distance, in texels, from every texel to the closest texel whose mask equals bInSiteValue. */
+	void SquaredDistanceTransform2D(const TArray<bool>& InMask, bool bInSiteValue, const FIntPoint& InNumTexels, TArray<float>& OutSquaredDistances)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FPCGWaterDistanceField::SquaredDistanceTransform2D);
+
+		OutSquaredDistances.SetNumUninitialized(InMask.Num());
+		for (int32 Index = 0; Index < InMask.Num(); ++Index)
+		{
+			OutSquaredDistances[Index] = (InMask[Index] == bInSiteValue) ? 0.0f : TNumericLimits<float>::Max();
+		}
+
+		// Rows first, then columns, the transform is separable
+		ParallelFor(InNumTexels.Y, [&OutSquaredDistances, &InNumTexels](int32 Y)
+		{
+			TArray<int32> Sites;
+			TArray<double> Boundaries;
+			TArray<float> Costs;
+			SquaredDistanceTransform1D(MakeArrayView(OutSquaredDistances.GetData() + static_cast<int64>(Y) * InNumTexels.X, InNumTexels.X), Sites, Boundaries, Costs);
+		});
+
+		ParallelFor(InNumTexels.X, [&OutSquaredDistances, &InNumTexels](int32 X)
+		{
+			TArray<int32> Sites;
+			TArray<double> Boundaries;
+			TArray<float> Costs;
+			TArray<float> Column;
+			Column.SetNumUninitialized(InNumTexels.Y);
+
+			for (int32 Y = 0; Y < InNumTexels.Y; ++Y)
+			{
+				Column[Y] = OutSquaredDistances[static_cast<int64>(Y) * InNumTexels.X + X];
+			}
+
+			SquaredDistanceTransform1D(Column, Sites, Boundaries, Costs);
+
+			for (int32 Y = 0; Y < InNumTexels.Y; ++Y)
+			{
+				OutSquaredDistances[static_cast<int64>(Y) * InNumTexels.X + X] = Column[Y];
+			}
+		});
+	}
+}
+
+void FPCGWaterDistanceField::Build(const UPCGWaterData* InWaterData, const FBox& InBounds, double InTexelSize, int64 InMemoryBudget, double InMaxDistance)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FPCGWaterDistanceField::Build);
+
+	using namespace UE::PCGWaterInterop::Private;
+
+	check(InWaterData);
+
+	Distances.Reset();
+	NumTexels = FIntPoint::ZeroValue;
+	MaxDistance = FMath::Max(InMaxDistance, 0.0);
+
+	if (!InBounds.IsValid)
+	{
+		return;
+	}
+
+	Origin = FVector2D(InBounds.Min);
+	TexelSize = FMath::Max(InTexelSize, 1.0);
+
+	const FVector2D Extent(InBounds.GetSize());
+	const int64 MaxTexels = FMath::Max<int64>(1, InMemoryBudget / DistanceFieldBuildBytesPerTexel);
+
+	for (;;)
+	{
+		NumTexels.X = FMath::Max(1, FMath::CeilToInt32(Extent.X / TexelSize));
+		NumTexels.Y = FMath::Max(1, FMath::CeilToInt32(Extent.Y / TexelSize));
+
+		if (static_cast<int64>(NumTexels.X) * NumTexels.Y <= FMath::Min<int64>(MaxTexels, MAX_int32))
+		{
+			break;
+		}
+
+		TexelSize *= 2.0;
+	}
+
+	if (TexelSize > InTexelSize)
+	{
+		UE_LOG(LogPCG, Verbose, TEXT("FPCGWaterDistanceField::Build: texel size increased from %f to %f to fit in the memory budget."), InTexelSize, TexelSize);
+	}
+
+	const int32 NumTotalTexels = NumTexels.X * NumTexels.Y;
+
+	// In-water mask at the texel centers, one batched query per row. Sample from the bottom of the bounds, since only locations under the water surface are reported as in water.
+	TArray<bool> InWater;
+	InWater.SetNumUninitialized(NumTotalTexels);
+
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FPCGWaterDistanceField::Build::Mask);
+
+		const double SampleZ = InBounds.Min.Z;
+		ParallelFor(NumTexels.Y, [this, InWaterData, &InWater, SampleZ](int32 Y)
+		{
+			TArray<FVector> Locations;
+			Locations.SetNumUninitialized(NumTexels.X);
+			for (int32 X = 0; X < NumTexels.X; ++X)
+			{
+				Locations[X] = FVector(Origin.X + (X + 0.5) * TexelSize, Origin.Y + (Y + 0.5) * TexelSize, SampleZ);
+			}
+
+			TArray<FPCGWaterSurfaceSample> Samples;
+			Samples.SetNum(NumTexels.X);
+			InWaterData->SampleWaterSurface(Locations, Samples);
+
+			for (int32 X = 0; X < NumTexels.X; ++X)
+			{
+				InWater[Y * NumTexels.X + X] = Samples[X].IsInWater();
+			}
+		});
+	}
+
+	// Land texels get their distance to the closest water texel, water texels their distance to the closest land texel.
+	// The shore lies between the two, half a texel from each.
+	SquaredDistanceTransform2D(InWater, /*bInSiteValue=*/true, NumTexels, Distances);
+
+	TArray<float> SquaredDistancesToLand;
+	SquaredDistanceTransform2D(InWater, /*bInSiteValue=*/false, NumTexels, SquaredDistancesToLand);
+
+	const float HalfTexel = static_cast<float>(0.5 * TexelSize);
+	const float MaxDistanceFloat = static_cast<float>(MaxDistance);
+
+	for (int32 Index = 0; Index < NumTotalTexels; ++Index)
+	{
+		const float SquaredDistance = InWater[Index] ? SquaredDistancesToLand[Index] : Distances[Index];
+		const float Distance = (SquaredDistance == TNumericLimits<float>::Max())
+			? MaxDistanceFloat
+			: FMath::Min(FMath::Sqrt(SquaredDistance) * static_cast<float>(TexelSize) - HalfTexel, MaxDistanceFloat);
+
+		Distances[Index] = InWater[Index] ? -Distance : Distance;
+	}
+}
+
+float FPCGWaterDistanceField::GetSignedDistance(const FVector& InLocation) const
+{
+	if (Distances.IsEmpty())
+	{
+		return static_cast<float>(MaxDistance);
+	}
+
+	// Texel coordinates relative to the texel centers
+	const FVector2D Coords = (FVector2D(InLocation) - Origin) / TexelSize - FVector2D(0.5);
+	if (Coords.X < -0.5 || Coords.Y < -0.5 || Coords.X > NumTexels.X - 0.5 || Coords.Y > NumTexels.Y - 0.5)
+	{
+		return static_cast<float>(MaxDistance);
+	}
+
+	const int32 X0 = FMath::Clamp(FMath::FloorToInt32(Coords.X), 0, NumTexels.X - 1);
+	const int32 Y0 = FMath::Clamp(FMath::FloorToInt32(Coords.Y), 0, NumTexels.Y - 1);
+	const int32 X1 = FMath::Min(X0 + 1, NumTexels.X - 1);
+	const int32 Y1 = FMath::Min(Y0 + 1, NumTexels.Y - 1);
+	const float FracX = static_cast<float>(FMath::Clamp(Coords.X - X0, 0.0, 1.0));
+	const float FracY = static_cast<float>(FMath::Clamp(Coords.Y - Y0, 0.0, 1.0));
+
+	return FMath::BiLerp(
+		Distances[Y0 * NumTexels.X + X0],
+		Distances[Y0 * NumTexels.X + X1],
+		Distances[Y1 * NumTexels.X + X0],
+		Distances[Y1 * NumTexels.X + X1],
+		FracX, FracY);
+}
+
+FPCGWaterCacheKey FPCGWaterDistanceField::ComputeKey(const UPCGWaterData* InWaterData, const FBox& InBounds, double InTexelSize, double InMaxDistance)
+{
+	check(InWaterData);
+
+	FPCGWaterCacheKey Key;
+
+	const UPCGWaterSnapshot* Snapshot = InWaterData->GetSnapshot();
+
+	// Fields read from a snapshot only depend on its bake, keyed below, the bodies can be edited without changing it.
+	// Otherwise they depend on the bodies at the revision they were resolved at. Body order depends on discovery, and doesn't change the field, so the bodies are sorted.
+	if (!Snapshot)
+	{
+		const TConstArrayView<FPCGWaterBodyEntry> Entries = InWaterData->GetWaterBodyEntries();
+		Key.WaterBodies.Reserve(Entries.Num());
+		Key.WaterBodyRevisions.Reserve(Entries.Num());
+		for (int32 Index = 0; Index < Entries.Num(); ++Index)
+		{
+			Key.AddWaterBody(InWaterData->WaterBodies[Index].ToSoftObjectPath(), Entries[Index].Revision);
+		}
+
+		Key.SortWaterBodies();
+	}
+
+	Key.AddSetting(InBounds);
+	Key.AddSetting(InTexelSize);
+	Key.AddSetting(InMaxDistance);
+
+	// Everything deciding which locations are in water: the exclusion volumes mask out water, snapshots and rasters answer at their own resolution.
+	Key.AddSetting(InWaterData->IsIncludingWaves());
+	Key.AddSetting(InWaterData->IsApplyingExclusionVolumes());
+	Key.AddSetting(InWaterData->GetRasterTexelSize());
+	Key.AddSetting(FSoftObjectPath(Snapshot));
+	Key.AddSetting(Snapshot ? Snapshot->GetBakeGuid() : FGuid());
+
+	return Key;
+}
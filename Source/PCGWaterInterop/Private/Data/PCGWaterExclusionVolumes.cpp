@@ -0,0 +1,37 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Data/PCGWaterExclusionVolumes.h"
+
+#include "Data/PCGWaterData.h"
+
+void FPCGWaterExclusionVolumes::Build(TConstArrayView<FPCGWaterBodyEntry> InWaterBodyEntries)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FPCGWaterExclusionVolumes::Build);
+
+	ExcludedBodies.Reset();
+
+	TMap<FObjectKey, int32> VolumeIndices;
+	TArray<FBox> VolumeBounds;
+
+	// Bodies are visited in order, so the excluded bodies of every volume come out sorted
+	for (int32 WaterBodyIndex = 0; WaterBodyIndex < InWaterBodyEntries.Num(); ++WaterBodyIndex)
+	{
+		for (const FPCGWaterExclusionVolume& ExclusionVolume : InWaterBodyEntries[WaterBodyIndex].ExclusionVolumes)
+		{
+			int32* ExistingIndex = VolumeIndices.Find(ExclusionVolume.Volume);
+			if (!ExistingIndex)
+			{
+				ExistingIndex = &VolumeIndices.Add(ExclusionVolume.Volume, VolumeBounds.Add(ExclusionVolume.Bounds));
+				ExcludedBodies.AddDefaulted();
+			}
+
+			TArray<int32>& Bodies = ExcludedBodies[*ExistingIndex];
+			if (Bodies.IsEmpty() || Bodies.Last() != WaterBodyIndex)
+			{
+				Bodies.Add(WaterBodyIndex);
+			}
+		}
+	}
+
+	VolumeIndex.Build(VolumeBounds);
+}
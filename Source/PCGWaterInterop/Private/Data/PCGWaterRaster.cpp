@@ -0,0 +1,241 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Data/PCGWaterRaster.h"
+
+#include "Data/PCGWaterData.h"
+#include "PCGModule.h"
+
+#include "Async/ParallelFor.h"
+
+namespace UE::PCGWaterInterop::Private
+{
+	// Upper bound on the tile grid evaluated against the tile filter, the texel size is increased past it.
+	constexpr int64 MaxRasterTiles = 1 << 20;
+}
+
+void FPCGWaterRaster::Build(const FBox& InBounds, double InTexelSize, int64 InMemoryBudget, bool bInBakeVelocity, FSampleFunc InSampleFunc, FTileFilterFunc InTileFilterFunc)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FPCGWaterRaster::Build);
+
+	TileIndices.Reset();
+	Tiles.Reset();
+	NumTiles = FIntPoint::ZeroValue;
+
+	if (!InBounds.IsValid)
+	{
+		return;
+	}
+
+	Origin = FVector2D(InBounds.Min);
+	Extent = FVector2D(InBounds.GetSize());
+	TexelSize = FMath::Max(InTexelSize, 1.0);
+
+	const int64 MaxTilesInBudget = FMath::Max<int64>(1, InMemoryBudget / GetTileMemorySize(bInBakeVelocity));
+
+	// Find the tiles that can contain water, coarsening the raster until they fit in the memory budget.
+	TArray<FIntPoint> WaterTiles;
+	for (;;)
+	{
+		const double TileWorldSize = TexelSize * TileSize;
+		NumTiles.X = FMath::Max(1, FMath::CeilToInt32(Extent.X / TileWorldSize));
+		NumTiles.Y = FMath::Max(1, FMath::CeilToInt32(Extent.Y / TileWorldSize));
+
+		const int64 NumTotalTiles = static_cast<int64>(NumTiles.X) * NumTiles.Y;
+		if (NumTotalTiles > UE::PCGWaterInterop::Private::MaxRasterTiles)
+		{
+			TexelSize *= 2.0;
+			continue;
+		}
+
+		WaterTiles.Reset();
+		for (int32 TileY = 0; TileY < NumTiles.Y; ++TileY)
+		{
+			for (int32 TileX = 0; TileX < NumTiles.X; ++TileX)
+			{
+				const FVector2D TileMin = Origin + FVector2D(TileX, TileY) * TileWorldSize;
+				if (InTileFilterFunc(FBox2D(TileMin, TileMin + FVector2D(TileWorldSize))))
+				{
+					WaterTiles.Emplace(TileX, TileY);
+				}
+			}
+		}
+
+		if (WaterTiles.Num() <= MaxTilesInBudget)
+		{
+			break;
+		}
+
+		TexelSize *= 2.0;
+	}
+
+	if (TexelSize > InTexelSize)
+	{
+		UE_LOG(LogPCG, Verbose, TEXT("FPCGWaterRaster::Build: texel size increased from %f to %f to fit in the memory budget."), InTexelSize, TexelSize);
+	}
+
+	TileIndices.Init(INDEX_NONE, NumTiles.X * NumTiles.Y);
+	Tiles.SetNum(WaterTiles.Num());
+	for (int32 TileIndex = 0; TileIndex < WaterTiles.Num(); ++TileIndex)
+	{
+		TileIndices[WaterTiles[TileIndex].Y * NumTiles.X + WaterTiles[TileIndex].X] = TileIndex;
+	}
+
+	// Sample from the bottom of the bounds, since only locations under the water surface are reported as in water.
+	const double SampleZ = InBounds.Min.Z;
+
+	ParallelFor(WaterTiles.Num(), [this, &WaterTiles, SampleZ, bInBakeVelocity, &InSampleFunc](int32 TileIndex)
+	{
+		const FVector2D TileMin = Origin + FVector2D(WaterTiles[TileIndex]) * (TexelSize * TileSize);
+		constexpr int32 NumSamples = TileSamples * TileSamples;
+
+		TArray<FVector> Locations;
+		Locations.SetNumUninitialized(NumSamples);
+		for (int32 Y = 0; Y < TileSamples; ++Y)
+		{
+			for (int32 X = 0; X < TileSamples; ++X)
+			{
+				Locations[Y * TileSamples + X] = FVector(TileMin.X + X * TexelSize, TileMin.Y + Y * TexelSize, SampleZ);
+			}
+		}
+
+		TArray<FPCGWaterSurfaceSample> Samples;
+		Samples.SetNum(NumSamples);
+		InSampleFunc(Locations, Samples);
+
+		FTile& Tile = Tiles[TileIndex];
+		Tile.Heights.SetNumUninitialized(NumSamples);
+		Tile.Normals.SetNumUninitialized(NumSamples);
+		Tile.WaterBodyIndices.SetNumUninitialized(NumSamples);
+		Tile.Velocities.SetNumUninitialized(bInBakeVelocity ? NumSamples : 0);
+
+		for (int32 SampleIndex = 0; SampleIndex < NumSamples; ++SampleIndex)
+		{
+			const FPCGWaterSurfaceSample& Sample = Samples[SampleIndex];
+			Tile.Heights[SampleIndex] = static_cast<float>(Sample.Location.Z);
+			Tile.Normals[SampleIndex] = FVector3f(Sample.Normal);
+			Tile.WaterBodyIndices[SampleIndex] = Sample.WaterBodyIndex;
+
+			if (bInBakeVelocity)
+			{
+				Tile.Velocities[SampleIndex] = FVector3f(Sample.Velocity);
+			}
+		}
+	});
+}
+
+bool FPCGWaterRaster::Contains(const FVector& InLocation) const
+{
+	if (NumTiles.X == 0)
+	{
+		return false;
+	}
+
+	const FVector2D Local = FVector2D(InLocation) - Origin;
+	return Local.X >= 0.0 && Local.Y >= 0.0 && Local.X <= Extent.X && Local.Y <= Extent.Y;
+}
+
+bool FPCGWaterRaster::Sample(const FVector& InLocation, FPCGWaterSurfaceSample& OutSample) const
+{
+	OutSample = FPCGWaterSurfaceSample();
+
+	if (NumTiles.X == 0)
+	{
+		return false;
+	}
+
+	const FVector2D TexelCoords = (FVector2D(InLocation) - Origin) / TexelSize;
+	const int32 TexelX = FMath::Clamp(FMath::FloorToInt32(TexelCoords.X), 0, NumTiles.X * TileSize - 1);
+	const int32 TexelY = FMath::Clamp(FMath::FloorToInt32(TexelCoords.Y), 0, NumTiles.Y * TileSize - 1);
+	const int32 TileX = TexelX / TileSize;
+	const int32 TileY = TexelY / TileSize;
+
+	const int32 TileIndex = TileIndices[TileY * NumTiles.X + TileX];
+	if (TileIndex == INDEX_NONE)
+	{
+		return false;
+	}
+
+	const FTile& Tile = Tiles[TileIndex];
+	const double FracX = FMath::Clamp(TexelCoords.X - TexelX, 0.0, 1.0);
+	const double FracY = FMath::Clamp(TexelCoords.Y - TexelY, 0.0, 1.0);
+
+	const int32 Index00 = (TexelY - TileY * TileSize) * TileSamples + (TexelX - TileX * TileSize);
+	const int32 Index10 = Index00 + 1;
+	const int32 Index01 = Index00 + TileSamples;
+	const int32 Index11 = Index01 + 1;
+
+	// The nearest sample decides which body, if any, owns the location.
+	const int32 NearestIndex = (FracY < 0.5) ? (FracX < 0.5 ? Index00 : Index10) : (FracX < 0.5 ? Index01 : Index11);
+	const int32 WaterBodyIndex = Tile.WaterBodyIndices[NearestIndex];
+	if (WaterBodyIndex == INDEX_NONE)
+	{
+		return false;
+	}
+
+	const bool bHasVelocity = !Tile.Velocities.IsEmpty();
+	float Height = Tile.Heights[NearestIndex];
+	FVector3f Normal = Tile.Normals[NearestIndex];
+	FVector3f Velocity = bHasVelocity ? Tile.Velocities[NearestIndex] : FVector3f::ZeroVector;
+
+	// Only interpolate inside a single body, to avoid blending with dry samples or across shores.
+	if (Tile.WaterBodyIndices[Index00] == WaterBodyIndex && Tile.WaterBodyIndices[Index10] == WaterBodyIndex
+		&& Tile.WaterBodyIndices[Index01] == WaterBodyIndex && Tile.WaterBodyIndices[Index11] == WaterBodyIndex)
+	{
+		Height = FMath::BiLerp(Tile.Heights[Index00], Tile.Heights[Index10], Tile.Heights[Index01], Tile.Heights[Index11], static_cast<float>(FracX), static_cast<float>(FracY));
+		Normal = FMath::BiLerp(Tile.Normals[Index00], Tile.Normals[Index10], Tile.Normals[Index01], Tile.Normals[Index11], static_cast<float>(FracX), static_cast<float>(FracY));
+
+		if (bHasVelocity)
+		{
+			Velocity = FMath::BiLerp(Tile.Velocities[Index00], Tile.Velocities[Index10], Tile.Velocities[Index01], Tile.Velocities[Index11], static_cast<float>(FracX), static_cast<float>(FracY));
+		}
+	}
+
+	OutSample.Location = FVector(InLocation.X, InLocation.Y, Height);
+	OutSample.Normal = FVector(Normal.GetSafeNormal(UE_SMALL_NUMBER, FVector3f::UpVector));
+	OutSample.ImmersionDepth = static_cast<float>(Height - InLocation.Z);
+	OutSample.Velocity = FVector(Velocity);
+
+	if (OutSample.ImmersionDepth <= 0.0f)
+	{
+		return false;
+	}
+
+	OutSample.WaterBodyIndex = WaterBodyIndex;
+	return true;
+}
+
+void FPCGWaterRaster::Serialize(FArchive& Ar)
+{
+	Ar << Origin;
+	Ar << Extent;
+	Ar << TexelSize;
+	Ar << NumTiles;
+	TileIndices.BulkSerialize(Ar);
+
+	int32 NumAllocatedTiles = Tiles.Num();
+	Ar << NumAllocatedTiles;
+
+	if (Ar.IsLoading())
+	{
+		Tiles.SetNum(NumAllocatedTiles);
+	}
+
+	for (FTile& Tile : Tiles)
+	{
+		Tile.Heights.BulkSerialize(Ar);
+		Tile.Normals.BulkSerialize(Ar);
+		Tile.WaterBodyIndices.BulkSerialize(Ar);
+		Tile.Velocities.BulkSerialize(Ar);
+	}
+}
+
+SIZE_T FPCGWaterRaster::GetAllocatedSize() const
+{
+	SIZE_T AllocatedSize = TileIndices.GetAllocatedSize() + Tiles.GetAllocatedSize();
+	for (const FTile& Tile : Tiles)
+	{
+		AllocatedSize += Tile.Heights.GetAllocatedSize() + Tile.Normals.GetAllocatedSize() + Tile.WaterBodyIndices.GetAllocatedSize() + Tile.Velocities.GetAllocatedSize();
+	}
+
+	return AllocatedSize;
+}
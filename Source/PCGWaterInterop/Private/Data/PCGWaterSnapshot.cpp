@@ -0,0 +1,185 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Data/PCGWaterSnapshot.h"
+
+#include "Data/PCGWaterBodyIndex.h"
+#include "Data/PCGWaterData.h"
+#include "Data/PCGWaterRaster.h"
+#include "Helpers/PCGHelpers.h"
+#include "PCGModule.h"
+#include "PCGWaterSubsystem.h"
+#include "WaterBodyActor.h"
+
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+
+void UPCGWaterSnapshot::Serialize(FArchive& Ar)
+{
+	Super::Serialize(Ar);
+
+	bool bHasRaster = Raster.IsValid();
+	Ar << bHasRaster;
+
+	if (Ar.IsLoading())
+	{
+		Raster = bHasRaster ? MakeShared<FPCGWaterRaster>() : nullptr;
+	}
+
+	if (bHasRaster)
+	{
+		Raster->Serialize(Ar);
+	}
+}
+
+void UPCGWaterSnapshot::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+
+	if (Raster.IsValid())
+	{
+		CumulativeResourceSize.AddDedicatedSystemMemoryBytes(Raster->GetAllocatedSize());
+	}
+}
+
+#if WITH_EDITOR
+void UPCGWaterSnapshot::Rebuild(UWorld* InWorld)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UPCGWaterSnapshot::Rebuild);
+
+	check(IsInGameThread());
+
+	bStale = false;
+
+	UPCGWaterSubsystem* WaterSubsystem = UPCGWaterSubsystem::GetInstance(InWorld);
+	if (!WaterSubsystem)
+	{
+		return;
+	}
+
+	// Bodies are ordered by path so rebuilding the same water gives the same snapshot
+	TArray<TWeakObjectPtr<AWaterBody>> WaterBodies;
+	WaterSubsystem->ForEachWaterBody(FBox(EForceInit::ForceInit), [&WaterBodies](AActor* InActor)
+	{
+		if (AWaterBody* WaterBody = Cast<AWaterBody>(InActor))
+		{
+			WaterBodies.Add(WaterBody);
+		}
+
+		return true;
+	});
+
+	WaterBodies.Sort([](const TWeakObjectPtr<AWaterBody>& A, const TWeakObjectPtr<AWaterBody>& B)
+	{
+		return A->GetPathName() < B->GetPathName();
+	});
+
+	Modify();
+
+	BakeGuid = FGuid::NewGuid();
+	Bodies.Reset(WaterBodies.Num());
+	Bounds = FBox(EForceInit::ForceInit);
+	Raster.Reset();
+
+	if (WaterBodies.IsEmpty())
+	{
+		return;
+	}
+
+	TArray<FBox> BodyBounds;
+	BodyBounds.Reserve(WaterBodies.Num());
+
+	for (const TWeakObjectPtr<AWaterBody>& WaterBody : WaterBodies)
+	{
+		FPCGWaterSnapshotBody& Body = Bodies.Emplace_GetRef();
+		Body.WaterBody = WaterBody.Get();
+		Body.Type = WaterBody->GetWaterBodyType();
+		Body.Bounds = (Body.Type == EWaterBodyType::Ocean) ? FBox(EForceInit::ForceInit) : PCGHelpers::GetActorBounds(WaterBody.Get());
+		Body.Tags = WaterBody->Tags;
+
+		BodyBounds.Add(Body.Bounds);
+		Bounds += PCGHelpers::GetGridBounds(WaterBody.Get(), nullptr);
+	}
+
+	Transform = WaterBodies[0]->GetActorTransform();
+
+	// Sample through a transient water data over the same bodies, so the snapshot matches what the bodies would answer
+	EPCGWaterAttributes Attributes = EPCGWaterAttributes::WaterBodyType | EPCGWaterAttributes::Depth;
+	Attributes |= bBakeVelocity ? EPCGWaterAttributes::Velocity : EPCGWaterAttributes::None;
+
+	UPCGWaterData* BakeData = NewObject<UPCGWaterData>();
+	BakeData->Initialize(WaterBodies, Bounds, /*bInUseMetadata=*/true, Attributes, bApplyExclusionVolumes);
+	BakeData->SetQueryMode(/*bInHeightOnly=*/false, bIncludeWaves);
+
+	FPCGWaterBodyIndex BodyIndex;
+	BodyIndex.Build(BodyBounds);
+
+	TSharedPtr<FPCGWaterRaster> NewRaster = MakeShared<FPCGWaterRaster>();
+	NewRaster->Build(Bounds, TexelSize, static_cast<int64>(MemoryBudgetMB * 1024.0 * 1024.0), bBakeVelocity,
+		[BakeData](TConstArrayView<FVector> InLocations, TArrayView<FPCGWaterSurfaceSample> OutSamples)
+		{
+			BakeData->SampleWaterSurface(InLocations, OutSamples);
+		},
+		[&BodyIndex](const FBox2D& InTileBounds)
+		{
+			return BodyIndex.HasBodyOverlapping(InTileBounds);
+		});
+
+	Raster = MoveTemp(NewRaster);
+
+	MarkPackageDirty();
+}
+
+void UPCGWaterSnapshot::RebuildFromEditorWorld()
+{
+	UWorld* EditorWorld = nullptr;
+	if (GEngine)
+	{
+		for (const FWorldContext& WorldContext : GEngine->GetWorldContexts())
+		{
+			if (WorldContext.WorldType == EWorldType::Editor)
+			{
+				EditorWorld = WorldContext.World();
+				break;
+			}
+		}
+	}
+
+	if (!EditorWorld)
+	{
+		return;
+	}
+
+	if (!CanRebuildFromLoadedWater(EditorWorld))
+	{
+		UE_LOG(LogPCG, Warning, TEXT("UPCGWaterSnapshot::RebuildFromEditorWorld: some water bodies of '%s' aren't loaded and are left out of the new bake."), *GetPathName());
+	}
+
+	Rebuild(EditorWorld);
+
+	if (UPCGWaterSubsystem* WaterSubsystem = UPCGWaterSubsystem::GetInstance(EditorWorld))
+	{
+		WaterSubsystem->OnWaterSnapshotRebuilt(this);
+	}
+}
+
+bool UPCGWaterSnapshot::IsAffectedByWaterEdit(TConstArrayView<FSoftObjectPath> InWaterBodies, const FBox& InBounds) const
+{
+	if (InBounds.IsValid && Bounds.IsValid && InBounds.Intersect(Bounds))
+	{
+		return true;
+	}
+
+	return Bodies.ContainsByPredicate([InWaterBodies](const FPCGWaterSnapshotBody& InBody) { return InWaterBodies.Contains(InBody.WaterBody.ToSoftObjectPath()); });
+}
+
+bool UPCGWaterSnapshot::CanRebuildFromLoadedWater(const UWorld* InWorld) const
+{
+	// The registered bodies of a partitioned world are only the loaded ones, rebaking would drop the others from the asset.
+	if (!InWorld || !InWorld->IsPartitionedWorld())
+	{
+		return true;
+	}
+
+	return !Bodies.ContainsByPredicate([](const FPCGWaterSnapshotBody& InBody) { return !InBody.WaterBody.IsValid(); });
+}
+#endif
@@ -0,0 +1,227 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Data/PCGWaterWaveKernel.h"
+
+#include "GerstnerWaterWaves.h"
+#include "WaterBodyComponent.h"
+#include "WaterWaves.h"
+
+#include "Math/VectorRegister.h"
+
+namespace UE::PCGWaterInterop::Private
+{
+	// Fixed point iterations used to invert the horizontal displacement of the waves.
+	constexpr int32 WaveDisplacementIterations = 3;
+
+	// Distance from the phase origin past which the origin moves, in cm. Float offsets below it are precise to about a thousandth of a cm.
+	constexpr double PhaseOriginMaxDistance = 1.0e4;
+
+	bool IsNearOrigin(TConstArrayView<FVector> InPositions, const FVector2D& InOrigin)
+	{
+		for (const FVector& Position : InPositions)
+		{
+			if (FMath::Abs(Position.X - InOrigin.X) > PhaseOriginMaxDistance || FMath::Abs(Position.Y - InOrigin.Y) > PhaseOriginMaxDistance)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	const UGerstnerWaterWaves* GetGerstnerWaves(const UWaterBodyComponent* InComponent)
+	{
+		const UWaterWavesBase* WaterWaves = InComponent ? InComponent->GetWaterWaves() : nullptr;
+
+		if (const UWaterWavesAssetReference* WavesReference = Cast<UWaterWavesAssetReference>(WaterWaves))
+		{
+			const UWaterWavesAsset* WavesAsset = WavesReference->GetWaterWavesAsset();
+			WaterWaves = WavesAsset ? WavesAsset->GetWaterWaves() : nullptr;
+		}
+
+		return Cast<UGerstnerWaterWaves>(WaterWaves);
+	}
+}
+
+bool FPCGWaterWaveKernel::Initialize(const UWaterBodyComponent* InComponent)
+{
+	WaveVectorsX.Reset();
+	WaveVectorsY.Reset();
+	DirectionsX.Reset();
+	DirectionsY.Reset();
+	Amplitudes.Reset();
+	WaveSpeeds.Reset();
+	Qs.Reset();
+	WKAs.Reset();
+	QKs.Reset();
+
+	if (!InComponent || !InComponent->HasWaves())
+	{
+		return false;
+	}
+
+	const UGerstnerWaterWaves* GerstnerWaves = UE::PCGWaterInterop::Private::GetGerstnerWaves(InComponent);
+	if (!GerstnerWaves)
+	{
+		return false;
+	}
+
+	for (const FGerstnerWave& Wave : GerstnerWaves->GetGerstnerWaves())
+	{
+		const float WaveNumber = static_cast<float>(Wave.WaveVector.Size());
+
+		WaveVectorsX.Add(static_cast<float>(Wave.WaveVector.X));
+		WaveVectorsY.Add(static_cast<float>(Wave.WaveVector.Y));
+		DirectionsX.Add(static_cast<float>(Wave.Direction.X));
+		DirectionsY.Add(static_cast<float>(Wave.Direction.Y));
+		Amplitudes.Add(Wave.Amplitude);
+		WaveSpeeds.Add(Wave.WaveSpeed);
+		Qs.Add(Wave.Q);
+		WKAs.Add(WaveNumber * Wave.Amplitude);
+		QKs.Add(WaveNumber * Wave.Q);
+	}
+
+	return IsValid();
+}
+
+void FPCGWaterWaveKernel::Evaluate(TConstArrayView<FVector> InPositions, float InTime, TArrayView<float> OutHeights, TArrayView<FVector> OutNormals) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FPCGWaterWaveKernel::Evaluate);
+
+	check(InPositions.Num() == OutHeights.Num());
+	check(OutNormals.IsEmpty() || OutNormals.Num() == InPositions.Num());
+
+	const int32 NumPositions = InPositions.Num();
+	const int32 NumWaves = Amplitudes.Num();
+	const bool bComputeNormals = !OutNormals.IsEmpty();
+
+	// Phases are taken relative to an origin so large world coordinates keep their precision: the phase at the origin, time included,
+	// is computed in double once per wave, the lanes only add the phase of their offset from the origin with vector math.
+	// The origin moves to the positions when they get too far from it, for float offsets to stay precise.
+	FVector2D Origin = FVector2D::ZeroVector;
+	TArray<VectorRegister4Float, TInlineAllocator<16>> OriginPhases;
+	OriginPhases.SetNumUninitialized(NumWaves);
+
+	auto SetOrigin = [this, InTime, NumWaves, &Origin, &OriginPhases](const FVector2D& InOrigin)
+	{
+		Origin = InOrigin;
+
+		for (int32 WaveIndex = 0; WaveIndex < NumWaves; ++WaveIndex)
+		{
+			const double Phase = Origin.X * WaveVectorsX[WaveIndex] + Origin.Y * WaveVectorsY[WaveIndex] - WaveSpeeds[WaveIndex] * InTime;
+			OriginPhases[WaveIndex] = VectorSetFloat1(static_cast<float>(FMath::Fmod(Phase, UE_DOUBLE_TWO_PI)));
+		}
+	};
+
+	if (NumPositions > 0)
+	{
+		SetOrigin(FVector2D(InPositions[0]));
+	}
+
+	const VectorRegister4Float One = VectorOneFloat();
+	TArray<VectorRegister4Float, TInlineAllocator<16>> LanePhases;
+	LanePhases.SetNumUninitialized(NumWaves);
+
+	for (int32 BaseIndex = 0; BaseIndex < NumPositions; BaseIndex += 4)
+	{
+		const int32 NumLanes = FMath::Min(4, NumPositions - BaseIndex);
+
+		if (!UE::PCGWaterInterop::Private::IsNearOrigin(InPositions.Slice(BaseIndex, NumLanes), Origin))
+		{
+			SetOrigin(FVector2D(InPositions[BaseIndex]));
+		}
+
+		alignas(16) float OffsetsX[4];
+		alignas(16) float OffsetsY[4];
+		for (int32 Lane = 0; Lane < 4; ++Lane)
+		{
+			const FVector& Position = InPositions[BaseIndex + FMath::Min(Lane, NumLanes - 1)];
+			OffsetsX[Lane] = static_cast<float>(Position.X - Origin.X);
+			OffsetsY[Lane] = static_cast<float>(Position.Y - Origin.Y);
+		}
+
+		const VectorRegister4Float LaneOffsetX = VectorLoadAligned(OffsetsX);
+		const VectorRegister4Float LaneOffsetY = VectorLoadAligned(OffsetsY);
+
+		for (int32 WaveIndex = 0; WaveIndex < NumWaves; ++WaveIndex)
+		{
+			const VectorRegister4Float Phase = VectorMultiplyAdd(LaneOffsetX, VectorSetFloat1(WaveVectorsX[WaveIndex]), OriginPhases[WaveIndex]);
+			LanePhases[WaveIndex] = VectorMultiplyAdd(LaneOffsetY, VectorSetFloat1(WaveVectorsY[WaveIndex]), Phase);
+		}
+
+		// Find the undisplaced sample whose displaced location is the position, as an offset from the position.
+		VectorRegister4Float SampleX = VectorZeroFloat();
+		VectorRegister4Float SampleY = VectorZeroFloat();
+
+		for (int32 Iteration = 0; Iteration < UE::PCGWaterInterop::Private::WaveDisplacementIterations; ++Iteration)
+		{
+			VectorRegister4Float OffsetX = VectorZeroFloat();
+			VectorRegister4Float OffsetY = VectorZeroFloat();
+
+			for (int32 WaveIndex = 0; WaveIndex < NumWaves; ++WaveIndex)
+			{
+				VectorRegister4Float Theta = VectorMultiplyAdd(SampleX, VectorSetFloat1(WaveVectorsX[WaveIndex]), LanePhases[WaveIndex]);
+				Theta = VectorMultiplyAdd(SampleY, VectorSetFloat1(WaveVectorsY[WaveIndex]), Theta);
+
+				VectorRegister4Float Sin;
+				VectorRegister4Float Cos;
+				VectorSinCos(&Sin, &Cos, &Theta);
+
+				const VectorRegister4Float Offset1D = VectorNegate(VectorMultiply(VectorSetFloat1(Qs[WaveIndex]), Sin));
+				OffsetX = VectorMultiplyAdd(Offset1D, VectorSetFloat1(DirectionsX[WaveIndex]), OffsetX);
+				OffsetY = VectorMultiplyAdd(Offset1D, VectorSetFloat1(DirectionsY[WaveIndex]), OffsetY);
+			}
+
+			SampleX = VectorNegate(OffsetX);
+			SampleY = VectorNegate(OffsetY);
+		}
+
+		VectorRegister4Float Height = VectorZeroFloat();
+		VectorRegister4Float NormalX = VectorZeroFloat();
+		VectorRegister4Float NormalY = VectorZeroFloat();
+		VectorRegister4Float NormalZ = One;
+
+		for (int32 WaveIndex = 0; WaveIndex < NumWaves; ++WaveIndex)
+		{
+			VectorRegister4Float Theta = VectorMultiplyAdd(SampleX, VectorSetFloat1(WaveVectorsX[WaveIndex]), LanePhases[WaveIndex]);
+			Theta = VectorMultiplyAdd(SampleY, VectorSetFloat1(WaveVectorsY[WaveIndex]), Theta);
+
+			VectorRegister4Float Sin;
+			VectorRegister4Float Cos;
+			VectorSinCos(&Sin, &Cos, &Theta);
+
+			Height = VectorMultiplyAdd(VectorSetFloat1(Amplitudes[WaveIndex]), Cos, Height);
+
+			if (bComputeNormals)
+			{
+				const VectorRegister4Float Slope = VectorMultiply(VectorSetFloat1(WKAs[WaveIndex]), Sin);
+				NormalX = VectorMultiplyAdd(Slope, VectorSetFloat1(DirectionsX[WaveIndex]), NormalX);
+				NormalY = VectorMultiplyAdd(Slope, VectorSetFloat1(DirectionsY[WaveIndex]), NormalY);
+				NormalZ = VectorNegateMultiplyAdd(VectorSetFloat1(QKs[WaveIndex]), Cos, NormalZ);
+			}
+		}
+
+		alignas(16) float Heights[4];
+		VectorStoreAligned(Height, Heights);
+
+		for (int32 Lane = 0; Lane < NumLanes; ++Lane)
+		{
+			OutHeights[BaseIndex + Lane] = Heights[Lane];
+		}
+
+		if (bComputeNormals)
+		{
+			alignas(16) float NormalsX[4];
+			alignas(16) float NormalsY[4];
+			alignas(16) float NormalsZ[4];
+			VectorStoreAligned(NormalX, NormalsX);
+			VectorStoreAligned(NormalY, NormalsY);
+			VectorStoreAligned(NormalZ, NormalsZ);
+
+			for (int32 Lane = 0; Lane < NumLanes; ++Lane)
+			{
+				OutNormals[BaseIndex + Lane] = FVector(NormalsX[Lane], NormalsY[Lane], NormalsZ[Lane]).GetSafeNormal(UE_SMALL_NUMBER, FVector::UpVector);
+			}
+		}
+	}
+}
@@ -0,0 +1,182 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Elements/PCGWaterDistance.h"
+
+#include "Data/PCGPointData.h"
+#include "Data/PCGWaterData.h"
+#include "Data/PCGWaterDistanceField.h"
+#include "Metadata/PCGMetadataAttributeTpl.h"
+#include "PCGComponent.h"
+#include "PCGContext.h"
+#include "PCGPin.h"
+#include "PCGWaterSubsystem.h"
+
+#include "Async/ParallelFor.h"
+
+#define LOCTEXT_NAMESPACE "PCGWaterDistanceElement"
+
+namespace UE::PCGWaterInterop::Private
+{
+	TSharedPtr<const FPCGWaterDistanceField> GetDistanceField(UPCGWaterSubsystem* InSubsystem, const UPCGWaterData* InWaterData, const UPCGWaterDistanceSettings* InSettings)
+	{
+		const double MaxDistance = InSettings->MaxDistance;
+		const double TexelSize = InSettings->TexelSize;
+		const int64 MemoryBudget = static_cast<int64>(InSettings->MemoryBudgetMB * 1024.0 * 1024.0);
+		const FBox FieldBounds = InWaterData->GetBounds().ExpandBy(FVector(MaxDistance, MaxDistance, 0.0));
+
+		auto BuildDistanceField = [InWaterData, &FieldBounds, TexelSize, MemoryBudget, MaxDistance]() -> TSharedPtr<const FPCGWaterDistanceField>
+		{
+			TSharedPtr<FPCGWaterDistanceField> DistanceField = MakeShared<FPCGWaterDistanceField>();
+			DistanceField->Build(InWaterData, FieldBounds, TexelSize, MemoryBudget, MaxDistance);
+			return DistanceField;
+		};
+
+		if (!InSubsystem)
+		{
+			return BuildDistanceField();
+		}
+
+		return InSubsystem->FindOrBuildDistanceField(FPCGWaterDistanceField::ComputeKey(InWaterData, FieldBounds, TexelSize, MaxDistance), BuildDistanceField);
+	}
+}
+
+#if WITH_EDITOR
+FText UPCGWaterDistanceSettings::GetNodeTooltipText() const
+{
+	return LOCTEXT("WaterDistanceTooltip", "Computes the signed distance from the points to the water shoreline, positive on land and negative in water.");
+}
+#endif
+
+TArray<FPCGPinProperties> UPCGWaterDistanceSettings::InputPinProperties() const
+{
+	TArray<FPCGPinProperties> PinProperties;
+	PinProperties.Emplace(PCGPinConstants::DefaultInputLabel, EPCGDataType::Point);
+	PinProperties.Emplace(PCGWaterDistanceConstants::WaterLabel, EPCGDataType::Surface);
+
+	return PinProperties;
+}
+
+TArray<FPCGPinProperties> UPCGWaterDistanceSettings::OutputPinProperties() const
+{
+	TArray<FPCGPinProperties> PinProperties;
+	PinProperties.Emplace(PCGPinConstants::DefaultOutputLabel, EPCGDataType::Point);
+
+	return PinProperties;
+}
+
+FPCGElementPtr UPCGWaterDistanceSettings::CreateElement() const
+{
+	return MakeShared<FPCGWaterDistanceElement>();
+}
+
+bool FPCGWaterDistanceElement::ExecuteInternal(FPCGContext* Context) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FPCGWaterDistanceElement::Execute);
+
+	check(Context);
+
+	const UPCGWaterDistanceSettings* Settings = Context->GetInputSettings<UPCGWaterDistanceSettings>();
+	check(Settings);
+
+	UWorld* World = Context->SourceComponent.IsValid() ? Context->SourceComponent->GetWorld() : nullptr;
+	UPCGWaterSubsystem* Subsystem = UPCGWaterSubsystem::GetInstance(World);
+
+	// Multiple water data are merged by taking the closest water of all of them.
+	TArray<TSharedPtr<const FPCGWaterDistanceField>> DistanceFields;
+	for (const FPCGTaggedData& WaterInput : Context->InputData.GetInputsByPin(PCGWaterDistanceConstants::WaterLabel))
+	{
+		if (const UPCGWaterData* WaterData = Cast<UPCGWaterData>(WaterInput.Data))
+		{
+			DistanceFields.Add(UE::PCGWaterInterop::Private::GetDistanceField(Subsystem, WaterData, Settings));
+		}
+	}
+
+	if (DistanceFields.IsEmpty())
+	{
+		PCGE_LOG(Warning, GraphAndLog, LOCTEXT("NoWaterData", "No water data on the Water pin, points are passed through."));
+		Context->OutputData.TaggedData = Context->InputData.GetInputsByPin(PCGPinConstants::DefaultInputLabel);
+		return true;
+	}
+
+	const float MaxDistance = Settings->MaxDistance;
+	const float DensityFalloffDistance = FMath::Max(Settings->DensityFalloffDistance, 1.0f);
+
+	for (const FPCGTaggedData& Input : Context->InputData.GetInputsByPin(PCGPinConstants::DefaultInputLabel))
+	{
+		const UPCGPointData* InputPointData = Cast<UPCGPointData>(Input.Data);
+		if (!InputPointData)
+		{
+			PCGE_LOG(Warning, GraphAndLog, LOCTEXT("InputNotPointData", "Input is not point data, skipped."));
+			continue;
+		}
+
+		UPCGPointData* OutputPointData = NewObject<UPCGPointData>();
+		OutputPointData->InitializeFromData(InputPointData);
+
+		TArray<FPCGPoint>& Points = OutputPointData->GetMutablePoints();
+		Points = InputPointData->GetPoints();
+
+		TArray<float> Distances;
+		Distances.SetNumUninitialized(Points.Num());
+
+		ParallelFor(Points.Num(), [&Points, &Distances, &DistanceFields, MaxDistance, DensityFalloffDistance, Settings](int32 PointIndex)
+		{
+			const FVector Location = Points[PointIndex].Transform.GetLocation();
+
+			float Distance = MaxDistance;
+			for (const TSharedPtr<const FPCGWaterDistanceField>& DistanceField : DistanceFields)
+			{
+				Distance = FMath::Min(Distance, DistanceField->GetSignedDistance(Location));
+			}
+
+			Distances[PointIndex] = Distance;
+
+			if (Settings->bOutputToDensity)
+			{
+				Points[PointIndex].Density = 1.0f - FMath::Clamp(FMath::Abs(Distance) / DensityFalloffDistance, 0.0f, 1.0f);
+			}
+		});
+
+		// Attribute values are written in bulk, after allocating the entries of all the points at once.
+		if (Settings->bOutputToAttribute && !Points.IsEmpty())
+		{
+			UPCGMetadata* Metadata = OutputPointData->Metadata;
+			FPCGMetadataAttribute<float>* DistanceAttribute = Metadata->FindOrCreateAttribute<float>(Settings->AttributeName, MaxDistance, /*bAllowsInterpolation=*/true, /*bOverrideParent=*/false);
+
+			if (DistanceAttribute)
+			{
+				const int64 ParentKeyCount = Metadata->GetItemKeyCountForParent();
+				TArray<PCGMetadataEntryKey*> NewEntryKeys;
+				for (FPCGPoint& Point : Points)
+				{
+					if (Point.MetadataEntry == PCGInvalidEntryKey || Point.MetadataEntry < ParentKeyCount)
+					{
+						NewEntryKeys.Add(&Point.MetadataEntry);
+					}
+				}
+
+				Metadata->AddEntriesInPlace(NewEntryKeys);
+
+				TArray<PCGMetadataEntryKey> EntryKeys;
+				EntryKeys.SetNumUninitialized(Points.Num());
+				for (int32 PointIndex = 0; PointIndex < Points.Num(); ++PointIndex)
+				{
+					EntryKeys[PointIndex] = Points[PointIndex].MetadataEntry;
+				}
+
+				DistanceAttribute->SetValues(EntryKeys, Distances);
+			}
+			else
+			{
+				PCGE_LOG(Warning, GraphAndLog, FText::Format(LOCTEXT("AttributeCreationFailed", "Could not create the float attribute '{0}'."), FText::FromName(Settings->AttributeName)));
+			}
+		}
+
+		FPCGTaggedData& Output = Context->OutputData.TaggedData.Add_GetRef(Input);
+		Output.Data = OutputPointData;
+	}
+
+	return true;
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -2,16 +2,24 @@
 
 #include "Elements/PCGWaterGetter.h"
 
-#include "Algo/AnyOf.h"
-#include "Data/PCGPointData.h"
+#include "Algo/Unique.h"
+#include "Async/ParallelFor.h"
+#include "Data/PCGWaterCacheKey.h"
 #include "Data/PCGWaterData.h"
-#include "Elements/PCGMergeElement.h"
+#include "Data/PCGWaterSnapshot.h"
 #include "Helpers/PCGActorHelpers.h"
 #include "Helpers/PCGHelpers.h"
 #include "PCG/Private/Grid/PCGPartitionActor.h"
 #include "PCGComponent.h"
 #include "PCGSubsystem.h"
+#include "PCGWaterStats.h"
+#include "PCGWaterSubsystem.h"
+#include "Serialization/ArchiveCrc32.h"
+#include "Serialization/ArchiveObjectCrc32.h"
 #include "WaterBodyActor.h"
+#include "WaterBodyComponent.h"
+#include "WaterSplineComponent.h"
+#include "WaterWaves.h"
 
 #define LOCTEXT_NAMESPACE "PCGWaterGetterElements"
 
@@ -78,7 +86,20 @@ namespace UE::PCGWaterInterop::Private
 		return [](AActor* Actor) -> bool { return false; };
 	}
 	
-	TArray<AActor*> FindActors(const FPCGActorSelectorSettings& Settings, const UPCGComponent* InComponent, const TFunction<bool(const AActor*)>& BoundsCheck, const TFunction<bool(const AActor*)>& SelfIgnoreCheck)
+	// The water subsystem only knows about water bodies, so it can stand in for the world actors when the selection can only match water bodies anyway.
+	bool CanUseWaterSubsystem(const FPCGActorSelectorSettings& InSettings)
+	{
+		if (!FilterRequired(InSettings) || InSettings.ActorSelection == EPCGActorSelection::ByTag)
+		{
+			return true;
+		}
+
+		return InSettings.ActorSelection == EPCGActorSelection::ByClass
+			&& InSettings.ActorSelectionClass
+			&& (InSettings.ActorSelectionClass->IsChildOf(AWaterBody::StaticClass()) || AWaterBody::StaticClass()->IsChildOf(InSettings.ActorSelectionClass));
+	}
+
+	TArray<AActor*> FindActors(const FPCGActorSelectorSettings& Settings, const UPCGComponent* InComponent, const FBox& InQueryBounds, const TFunction<bool(const AActor*)>& BoundsCheck, const TFunction<bool(const AActor*)>& SelfIgnoreCheck)
 	{
 		TRACE_CPUPROFILER_EVENT_SCOPE(PCGActorSelector::FindActor);
 
@@ -108,6 +129,14 @@ namespace UE::PCGWaterInterop::Private
 		// In case of iterating over all actors in the world, call our filtering function and get out.
 		if (Settings.ActorFilter == EPCGActorFilter::AllWorldActors)
 		{
+			// Only visit the registered water bodies overlapping the query bounds, rather than every actor in the world.
+			UPCGWaterSubsystem* WaterSubsystem = UPCGWaterSubsystem::GetInstance(World);
+			if (WaterSubsystem && CanUseWaterSubsystem(Settings))
+			{
+				WaterSubsystem->ForEachWaterBody(InQueryBounds, FilteringFunction);
+				return FoundActors;
+			}
+
 			// A potential optimization if we know the sought actors are collide-able could be to obtain overlaps via a collision query.
 			UPCGActorHelpers::ForEachActorInWorld<AActor>(World, FilteringFunction);
 
@@ -197,6 +226,184 @@ namespace UE::PCGWaterInterop::Private
 
 		return FoundActors;
 	}
+
+	/** Finds the actors matching the settings actor selector, applying the bounds and self checks of the settings. */
+	TArray<AActor*> FindWaterActors(const UPCGDataFromActorSettings* Settings, const UPCGComponent* PCGComponent)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FPCGGetWaterDataElement::FindWaterActors);
+		SCOPE_CYCLE_COUNTER(STAT_PCGWater_ActorDiscovery);
+
+		check(Settings);
+
+		TFunction<bool(const AActor*)> BoundsCheck = [](const AActor*) -> bool { return true; };
+		FBox QueryBounds(EForceInit::ForceInit);
+		const AActor* Self = PCGComponent ? PCGComponent->GetOwner() : nullptr;
+		if (Self && Settings->ActorSelector.bMustOverlapSelf)
+		{
+			// Capture ActorBounds by value because it goes out of scope
+			const FBox ActorBounds = PCGHelpers::GetActorBounds(Self);
+			QueryBounds = ActorBounds;
+			BoundsCheck = [Settings, ActorBounds, PCGComponent](const AActor* OtherActor) -> bool
+			{
+				const FBox OtherActorBounds = OtherActor ? PCGHelpers::GetGridBounds(OtherActor, PCGComponent) : FBox(EForceInit::ForceInit);
+				return ActorBounds.Intersect(OtherActorBounds);
+			};
+		}
+
+		TFunction<bool(const AActor*)> SelfIgnoreCheck = [](const AActor*) -> bool { return true; };
+		if (Self && Settings->ActorSelector.bIgnoreSelfAndChildren)
+		{
+			SelfIgnoreCheck = [Self](const AActor* OtherActor) -> bool
+			{
+				// Check if OtherActor is a child of self
+				const AActor* CurrentOtherActor = OtherActor;
+				while (CurrentOtherActor)
+				{
+					if (CurrentOtherActor == Self)
+					{
+						return false;
+					}
+
+					CurrentOtherActor = CurrentOtherActor->GetParentActor();
+				}
+
+				// Check if Self is a child of OtherActor
+				const AActor* CurrentSelfActor = Self;
+				while (CurrentSelfActor)
+				{
+					if (CurrentSelfActor == OtherActor)
+					{
+						return false;
+					}
+
+					CurrentSelfActor = CurrentSelfActor->GetParentActor();
+				}
+
+				return true;
+			};
+		}
+
+		return FindActors(Settings->ActorSelector, PCGComponent, QueryBounds, BoundsCheck, SelfIgnoreCheck);
+	}
+
+	/** CRC of everything in a water body that affects the water data built from it: identity, transform, spline, water body and wave parameters. Only used without a water subsystem, see AddWaterBodyRevision. */
+	uint32 ComputeWaterBodyCrc(const AWaterBody* WaterBody)
+	{
+		check(WaterBody);
+
+		FArchiveCrc32 Ar;
+
+		FString WaterBodyPath = WaterBody->GetPathName();
+		Ar << WaterBodyPath;
+
+		FTransform WaterBodyTransform = WaterBody->GetActorTransform();
+		Ar << WaterBodyTransform;
+
+		uint32 Crc = Ar.GetCrc();
+
+		FArchiveObjectCrc32 ObjectCrcAr;
+		if (UWaterBodyComponent* WaterBodyComponent = WaterBody->GetWaterBodyComponent())
+		{
+			Crc = ObjectCrcAr.Crc32(WaterBodyComponent, Crc);
+		}
+
+		if (UWaterSplineComponent* WaterSpline = WaterBody->GetWaterSpline())
+		{
+			Crc = ObjectCrcAr.Crc32(WaterSpline, Crc);
+		}
+
+		if (UWaterWavesBase* WaterWaves = WaterBody->GetWaterWaves())
+		{
+			Crc = ObjectCrcAr.Crc32(WaterWaves, Crc);
+		}
+
+		return Crc;
+	}
+
+	/** Adds the identity of the water body and its revision in the water subsystem, which changes whenever anything the water data reads from it does. */
+	void AddWaterBodyRevision(FArchiveCrc32& Ar, const UPCGWaterSubsystem* InSubsystem, const AWaterBody* InWaterBody)
+	{
+		check(InSubsystem && InWaterBody);
+
+		const FSoftObjectPath WaterBodyPath(InWaterBody);
+		FString WaterBodyPathString = WaterBodyPath.ToString();
+		Ar << WaterBodyPathString;
+
+		uint32 Revision = InSubsystem->GetWaterBodyRevision(WaterBodyPath);
+		Ar << Revision;
+	}
+
+	/**
+	* Key of the water data shared through the water subsystem: the bodies, in order since it decides which body answers first, the revisions they were resolved at,
+	* and the settings used to build it.
+	*/
+	FPCGWaterCacheKey ComputeSharedWaterDataKey(TConstArrayView<FPCGWaterBodyEntry> InWaterBodyEntries, const UPCGGetWaterSettings* InSettings, EPCGWaterAttributes InAttributes)
+	{
+		check(InSettings);
+
+		FPCGWaterCacheKey Key;
+		Key.WaterBodies.Reserve(InWaterBodyEntries.Num());
+		Key.WaterBodyRevisions.Reserve(InWaterBodyEntries.Num());
+		for (const FPCGWaterBodyEntry& Entry : InWaterBodyEntries)
+		{
+			Key.AddWaterBody(Entry.WaterBody.ToSoftObjectPath(), Entry.Revision);
+		}
+
+		Key.AddSetting(InAttributes);
+		Key.AddSetting(InSettings->bHeightOnly);
+		Key.AddSetting(InSettings->bIncludeWaves);
+		Key.AddSetting(InSettings->bApplyExclusionVolumes);
+		Key.AddSetting(InSettings->bBakeRaster);
+
+		if (InSettings->bBakeRaster)
+		{
+			Key.AddSetting(InSettings->RasterTexelSize);
+			Key.AddSetting(InSettings->RasterMemoryBudgetMB);
+		}
+
+		return Key;
+	}
+
+	/** Water bodies output as one water data. */
+	struct FWaterBodyGroup
+	{
+		TArray<FPCGWaterBodyEntry> WaterBodyEntries;
+		FBox Bounds = FBox(EForceInit::ForceInit);
+
+		/** Tags stay names until the output is written, most bodies share the same few tags. */
+		TArray<FName, TInlineAllocator<16>> Tags;
+	};
+
+	EPCGWaterAttributes GetWaterAttributes(const UPCGGetWaterSettings* InSettings)
+	{
+		check(InSettings);
+
+		EPCGWaterAttributes Attributes = EPCGWaterAttributes::None;
+		Attributes |= InSettings->bOutputWaterBodyType ? EPCGWaterAttributes::WaterBodyType : EPCGWaterAttributes::None;
+		Attributes |= InSettings->bOutputDepth ? EPCGWaterAttributes::Depth : EPCGWaterAttributes::None;
+		Attributes |= InSettings->bOutputVelocity ? EPCGWaterAttributes::Velocity : EPCGWaterAttributes::None;
+		Attributes |= InSettings->bOutputWaterTags ? EPCGWaterAttributes::WaterTags : EPCGWaterAttributes::None;
+
+		return Attributes;
+	}
+
+	/** Applies the point generation settings to the water data and outputs it, tagged with the sorted, unique tags of its bodies. */
+	void OutputWaterData(FPCGContext* InContext, const UPCGGetWaterSettings* InSettings, UPCGWaterData* InWaterData, TConstArrayView<FName> InWaterTags)
+	{
+		check(InContext && InSettings && InWaterData);
+
+		InWaterData->PointSpacing = InSettings->PointSpacing;
+		InWaterData->AdaptiveSamplingLevels = InSettings->AdaptiveSamplingLevels;
+		InWaterData->AdaptiveDepthTolerance = InSettings->AdaptiveDepthTolerance;
+
+		FPCGTaggedData& TaggedData = InContext->OutputData.TaggedData.Emplace_GetRef();
+		TaggedData.Data = InWaterData;
+		TaggedData.Tags.Reserve(InWaterTags.Num());
+		for (FName Tag : InWaterTags)
+		{
+			TaggedData.Tags.Add(Tag.ToString());
+		}
+	}
 }
 
 UPCGGetWaterSettings::UPCGGetWaterSettings()
@@ -227,6 +434,22 @@ FText UPCGGetWaterSettings::GetNodeTooltipText() const
 }
 #endif
 
+#if WITH_EDITOR
+void UPCGGetWaterSettings::GetTrackedActorKeys(FPCGSelectionKeyToSettingsMap& OutKeysToSettings, TArray<TObjectPtr<const UPCGGraph>>& OutVisitedGraphs) const
+{
+	// The water subsystem refreshes the components overlapping water edits itself, see UPCGWaterSubsystem::RefreshWaterConsumers.
+	if (!IsTrackingWaterByRegion())
+	{
+		Super::GetTrackedActorKeys(OutKeysToSettings, OutVisitedGraphs);
+	}
+}
+
+bool UPCGGetWaterSettings::IsTrackingWaterByRegion() const
+{
+	return bRefreshOnlyDirtyRegions && ActorSelector.ActorFilter == EPCGActorFilter::AllWorldActors;
+}
+#endif
+
 FName UPCGGetWaterSettings::AdditionalTaskName() const
 {
 	// Do not use the version from data from actor otherwise we'll show the selected actor class, which serves no purpose
@@ -236,7 +459,7 @@ FName UPCGGetWaterSettings::AdditionalTaskName() const
 TArray<FPCGPinProperties> UPCGGetWaterSettings::OutputPinProperties() const
 {
 	TArray<FPCGPinProperties> PinProperties;
-	PinProperties.Emplace(PCGPinConstants::DefaultOutputLabel, EPCGDataType::Surface, /*bAllowMultipleConnections=*/true, /*bAllowMultipleData=*/false);
+	PinProperties.Emplace(PCGPinConstants::DefaultOutputLabel, EPCGDataType::Surface, /*bAllowMultipleConnections=*/true, /*bAllowMultipleData=*/true);
 
 	return PinProperties;
 }
@@ -256,7 +479,7 @@ FPCGContext* FPCGGetWaterDataElement::Initialize(
 	TWeakObjectPtr<UPCGComponent> SourceComponent,
 	const UPCGNode* Node)
 {
-	FPCGDataFromActorContext* Context = new FPCGDataFromActorContext();
+	FPCGGetWaterDataContext* Context = new FPCGGetWaterDataContext();
 	Context->InputData = InputData;
 	Context->SourceComponent = SourceComponent;
 	Context->Node = Node;
@@ -264,66 +487,114 @@ FPCGContext* FPCGGetWaterDataElement::Initialize(
 	return Context;
 }
 
-bool FPCGGetWaterDataElement::ExecuteInternal(FPCGContext* InContext) const
+void FPCGGetWaterDataElement::GetDependenciesCrc(const FPCGDataCollection& InInput, const UPCGSettings* InSettings, UPCGComponent* InComponent, FPCGCrc& OutCrc) const
 {
-	TRACE_CPUPROFILER_EVENT_SCOPE(FPCGDataFromActorElement::Execute);
+	// Reads the world's water bodies and loads the snapshot, see the declaration
+	check(IsInGameThread());
 
-	check(InContext);
-	FPCGDataFromActorContext* Context = static_cast<FPCGDataFromActorContext*>(InContext);
+	FPCGCrc Crc;
+	IPCGElement::GetDependenciesCrc(InInput, InSettings, InComponent, Crc);
 
-	const UPCGDataFromActorSettings* Settings = Context->GetInputSettings<UPCGDataFromActorSettings>();
-	check(Settings);
-
-	if (!Context->bPerformedQuery)
+	// Snapshot output only depends on the bake, and on the component bounds when it must overlap them. The loaded water bodies don't matter.
+	const UPCGGetWaterSettings* WaterSettings = Cast<UPCGGetWaterSettings>(InSettings);
+	if (WaterSettings && !WaterSettings->WaterSnapshot.IsNull())
 	{
-		TFunction<bool(const AActor*)> BoundsCheck = [](const AActor*) -> bool { return true; };
-		const UPCGComponent* PCGComponent = Context->SourceComponent.IsValid() ? Context->SourceComponent.Get() : nullptr;
-		const AActor* Self = PCGComponent ? PCGComponent->GetOwner() : nullptr;
-		if (Self && Settings->ActorSelector.bMustOverlapSelf)
+		FArchiveCrc32 Ar;
+		FString SnapshotPath = WaterSettings->WaterSnapshot.ToString();
+		Ar << SnapshotPath;
+
+		if (const UPCGWaterSnapshot* Snapshot = WaterSettings->WaterSnapshot.LoadSynchronous())
 		{
-			// Capture ActorBounds by value because it goes out of scope
-			const FBox ActorBounds = PCGHelpers::GetActorBounds(Self);
-			BoundsCheck = [Settings, ActorBounds, PCGComponent](const AActor* OtherActor) -> bool
-			{
-				const FBox OtherActorBounds = OtherActor ? PCGHelpers::GetGridBounds(OtherActor, PCGComponent) : FBox(EForceInit::ForceInit);
-				return ActorBounds.Intersect(OtherActorBounds);
-			};
+			FGuid BakeGuid = Snapshot->GetBakeGuid();
+			Ar << BakeGuid;
 		}
 
-		TFunction<bool(const AActor*)> SelfIgnoreCheck = [](const AActor*) -> bool { return true; };
-		if (Self && Settings->ActorSelector.bIgnoreSelfAndChildren)
+		if (WaterSettings->ActorSelector.bMustOverlapSelf && InComponent)
 		{
-			SelfIgnoreCheck = [Self](const AActor* OtherActor) -> bool
+			FBox GridBounds = InComponent->GetGridBounds();
+			Ar << GridBounds;
+		}
+
+		Crc.Combine(Ar.GetCrc());
+	}
+	else if (const UPCGDataFromActorSettings* Settings = Cast<UPCGDataFromActorSettings>(InSettings))
+	{
+		// The output only depends on the settings and on the water bodies that are found, so cells over the same bodies share their result,
+		// and an edited body only invalidates the cells that found it. Bodies are hashed through the revisions the water subsystem keeps for them.
+		UPCGWaterSubsystem* WaterSubsystem = UPCGWaterSubsystem::GetInstance(InComponent ? InComponent->GetWorld() : nullptr);
+		if (WaterSubsystem)
+		{
+			FArchiveCrc32 Ar;
+
+			if (Settings->ActorSelector.ActorFilter == EPCGActorFilter::AllWorldActors && UE::PCGWaterInterop::Private::CanUseWaterSubsystem(Settings->ActorSelector))
 			{
-				// Check if OtherActor is a child of self
-				const AActor* CurrentOtherActor = OtherActor;
-				while (CurrentOtherActor)
+				// Hashing every indexed body overlapping the component, without running the selection, is cheaper than the discovery done on execution.
+				// The selection settings are part of the settings CRC, bodies it rejects can only cause extra misses.
+				const AActor* Self = InComponent->GetOwner();
+				const FBox QueryBounds = (Self && Settings->ActorSelector.bMustOverlapSelf) ? PCGHelpers::GetActorBounds(Self) : FBox(EForceInit::ForceInit);
+
+				WaterSubsystem->ForEachWaterBody(QueryBounds, [&Ar, WaterSubsystem](AActor* InActor)
 				{
-					if (CurrentOtherActor == Self)
+					UE::PCGWaterInterop::Private::AddWaterBodyRevision(Ar, WaterSubsystem, CastChecked<AWaterBody>(InActor));
+					return true;
+				});
+			}
+			else
+			{
+				for (const AActor* FoundActor : UE::PCGWaterInterop::Private::FindWaterActors(Settings, InComponent))
+				{
+					if (const AWaterBody* WaterBody = Cast<AWaterBody>(FoundActor))
 					{
-						return false;
+						UE::PCGWaterInterop::Private::AddWaterBodyRevision(Ar, WaterSubsystem, WaterBody);
 					}
-
-					CurrentOtherActor = CurrentOtherActor->GetParentActor();
 				}
+			}
 
-				// Check if Self is a child of OtherActor
-				const AActor* CurrentSelfActor = Self;
-				while (CurrentSelfActor)
+			Crc.Combine(Ar.GetCrc());
+		}
+		else
+		{
+			// Without a water subsystem there are no revisions, the bodies' state is hashed instead
+			for (const AActor* FoundActor : UE::PCGWaterInterop::Private::FindWaterActors(Settings, InComponent))
+			{
+				if (const AWaterBody* WaterBody = Cast<AWaterBody>(FoundActor))
 				{
-					if (CurrentSelfActor == OtherActor)
-					{
-						return false;
-					}
-
-					CurrentSelfActor = CurrentSelfActor->GetParentActor();
+					Crc.Combine(UE::PCGWaterInterop::Private::ComputeWaterBodyCrc(WaterBody));
 				}
-
-				return true;
-			};
+			}
 		}
+	}
+
+	OutCrc = Crc;
+}
+
+bool FPCGGetWaterDataElement::CanExecuteOnlyOnMainThread(FPCGContext* Context) const
+{
+	return !Context || !static_cast<const FPCGGetWaterDataContext*>(Context)->bGatheredWaterBodies;
+}
+
+bool FPCGGetWaterDataElement::ExecuteInternal(FPCGContext* InContext) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FPCGGetWaterDataElement::Execute);
+
+	check(InContext);
+	FPCGGetWaterDataContext* Context = static_cast<FPCGGetWaterDataContext*>(InContext);
+
+	const UPCGDataFromActorSettings* Settings = Context->GetInputSettings<UPCGDataFromActorSettings>();
+	check(Settings);
 
-		Context->FoundActors = UE::PCGWaterInterop::Private::FindActors(Settings->ActorSelector, Context->SourceComponent.Get(), BoundsCheck, SelfIgnoreCheck);
+	// Snapshots replace the actor discovery, the water bodies don't have to be loaded
+	const UPCGGetWaterSettings* WaterSettings = Context->GetInputSettings<UPCGGetWaterSettings>();
+	if (WaterSettings && !WaterSettings->WaterSnapshot.IsNull())
+	{
+		check(IsInGameThread());
+		ProcessWaterSnapshot(Context, WaterSettings);
+		return true;
+	}
+
+	if (!Context->bPerformedQuery)
+	{
+		Context->FoundActors = UE::PCGWaterInterop::Private::FindWaterActors(Settings, Context->SourceComponent.Get());
 		Context->bPerformedQuery = true;
 
 		if (Context->FoundActors.IsEmpty())
@@ -366,14 +637,57 @@ bool FPCGGetWaterDataElement::ExecuteInternal(FPCGContext* InContext) const
 		}
 	}
 
-	if (Context->bPerformedQuery)
+	if (!Context->bGatheredWaterBodies)
 	{
-		ProcessActors(Context, Settings, Context->FoundActors);
+		// Capture the water bodies while on the main thread, then yield so the rest runs on a worker thread.
+		check(IsInGameThread());
+		GatherWaterBodies(Context);
+		Context->bGatheredWaterBodies = true;
+
+		if (Context->WaterBodyEntries.IsEmpty())
+		{
+			return true;
+		}
+
+		return false;
 	}
 
+	ProcessWaterBodies(Context, Settings, Context->WaterBodyEntries);
+
 	return true;
 }
 
+void FPCGGetWaterDataElement::GatherWaterBodies(FPCGGetWaterDataContext* Context) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FPCGGetWaterDataElement::GatherWaterBodies);
+
+	check(Context);
+
+	TArray<TWeakObjectPtr<AWaterBody>> WaterBodies;
+	WaterBodies.Reserve(Context->FoundActors.Num());
+
+	for (AActor* FoundActor : Context->FoundActors)
+	{
+		if (!FoundActor || !IsValid(FoundActor))
+		{
+			continue;
+		}
+
+		AWaterBody* WaterBody = Cast<AWaterBody>(FoundActor);
+		if (ensure(WaterBody))
+		{
+			WaterBodies.Add(WaterBody);
+		}
+	}
+
+	// Everything the water data needs from the actors is read here, the worker thread only gets these entries
+	const UPCGGetWaterSettings* Settings = Context->GetInputSettings<UPCGGetWaterSettings>();
+	Context->WaterBodyEntries = UPCGWaterData::ResolveWaterBodies(WaterBodies, Settings && Settings->bApplyExclusionVolumes);
+
+	// Raw actor pointers must not be used past this point
+	Context->FoundActors.Reset();
+}
+
 void FPCGGetWaterDataElement::GatherWaitTasks(AActor* FoundActor, FPCGContext* Context, TArray<FPCGTaskId>& OutWaitTasks) const
 {
 	if (!FoundActor)
@@ -396,123 +710,174 @@ void FPCGGetWaterDataElement::GatherWaitTasks(AActor* FoundActor, FPCGContext* C
 	}
 }
 
-void FPCGGetWaterDataElement::ProcessActors(
+void FPCGGetWaterDataElement::ProcessWaterBodies(
 	FPCGContext* InContext,
 	const UPCGDataFromActorSettings* InSettings,
-	const TArray<AActor*>& FoundActors) const
+	TConstArrayView<FPCGWaterBodyEntry> InWaterBodyEntries) const
 {
+	TRACE_CPUPROFILER_EVENT_SCOPE(FPCGGetWaterDataElement::ProcessWaterBodies);
+
 	check(InContext);
 	check(InSettings);
 
 	const UPCGGetWaterSettings* Settings = CastChecked<UPCGGetWaterSettings>(InSettings);
 
-	TArray<TWeakObjectPtr<AWaterBody>> WaterBodies;
-	FBox WaterBounds(EForceInit::ForceInit);
-	TSet<FString> WaterTags;
+	// Bodies are grouped per output data, groups and their bodies stay in discovery order.
+	TArray<UE::PCGWaterInterop::Private::FWaterBodyGroup> Groups;
+	TMap<EWaterBodyType, int32> TypeGroups;
 
-	for (AActor* FoundActor : FoundActors)
+	for (const FPCGWaterBodyEntry& Entry : InWaterBodyEntries)
 	{
-		if (!FoundActor || !IsValid(FoundActor))
+		int32 GroupIndex = 0;
+		if (Settings->OutputMode == EPCGWaterOutputMode::PerBody)
 		{
-			continue;
+			GroupIndex = Groups.AddDefaulted();
 		}
-
-		AWaterBody* WaterBody = Cast<AWaterBody>(FoundActor);
-		if (ensure(WaterBody))
+		else if (Settings->OutputMode == EPCGWaterOutputMode::PerBodyType)
 		{
-			WaterBodies.Add(WaterBody);
-			WaterBounds += PCGHelpers::GetGridBounds(WaterBody, nullptr);
-
-			for (FName Tag : WaterBody->Tags)
+			if (const int32* TypeGroupIndex = TypeGroups.Find(Entry.Type))
+			{
+				GroupIndex = *TypeGroupIndex;
+			}
+			else
 			{
-				WaterTags.Add(Tag.ToString());
+				GroupIndex = TypeGroups.Add(Entry.Type, Groups.AddDefaulted());
+				Groups[GroupIndex].Tags.Add(FName(StaticEnum<EWaterBodyType>()->GetNameStringByValue(static_cast<int64>(Entry.Type))));
 			}
 		}
+		else if (Groups.IsEmpty())
+		{
+			Groups.AddDefaulted();
+		}
+
+		UE::PCGWaterInterop::Private::FWaterBodyGroup& Group = Groups[GroupIndex];
+		Group.WaterBodyEntries.Add(Entry);
+		Group.Bounds += Entry.GridBounds;
+		Group.Tags.Append(Entry.ActorTags);
 	}
 
-	if (!WaterBodies.IsEmpty())
+	if (Groups.IsEmpty())
 	{
-		UPCGWaterData* WaterData = NewObject<UPCGWaterData>();
-		WaterData->Initialize(WaterBodies, WaterBounds, true);
-		
-		FPCGTaggedData& TaggedData = InContext->OutputData.TaggedData.Emplace_GetRef();
-		TaggedData.Data = WaterData;
-		TaggedData.Tags = WaterTags;
+		return;
 	}
-}
 
-void FPCGGetWaterDataElement::ProcessActor(
-	FPCGContext* InContext,
-	const UPCGDataFromActorSettings* InSettings,
-	AActor* FoundActor) const
-{
-	checkf(false, TEXT("This should never be called directly"));
-}
+	const EPCGWaterAttributes Attributes = UE::PCGWaterInterop::Private::GetWaterAttributes(Settings);
 
-void FPCGGetWaterDataElement::MergeActorsIntoPointData(
-	FPCGContext* InContext,
-	const UPCGDataFromActorSettings* InSettings,
-	const TArray<AActor*>& FoundActors) const
-{
-	check(InContext);
+	// Partition cells over the same water bodies share the built data (body index, wave kernels, raster) through the water subsystem,
+	// each one only outputs a copy of it.
+	UWorld* World = InContext->SourceComponent.IsValid() ? InContext->SourceComponent->GetWorld() : nullptr;
+	UPCGWaterSubsystem* WaterSubsystem = UPCGWaterSubsystem::GetInstance(World);
 
-	// At this point in time, the partition actors behave slightly differently, so if we are in the case where
-	// we have one or more partition actors, we'll go through the normal process and do post-processing to merge the point data instead.
-	const bool bContainsPartitionActors = Algo::AnyOf(FoundActors, [](const AActor* Actor) { return Cast<APCGPartitionActor>(Actor) != nullptr; });
+	TArray<UPCGWaterData*> GroupWaterData;
+	GroupWaterData.SetNumZeroed(Groups.Num());
 
-	if (!bContainsPartitionActors)
+	ParallelFor(Groups.Num(), [Settings, &Groups, &GroupWaterData, Attributes, WaterSubsystem](int32 GroupIndex)
 	{
-		UPCGPointData* Data = NewObject<UPCGPointData>();
-		bool bHasData = false;
+		const UE::PCGWaterInterop::Private::FWaterBodyGroup& Group = Groups[GroupIndex];
 
-		for (AActor* Actor : FoundActors)
+		auto BuildWaterData = [Settings, &Group, Attributes]() -> UPCGWaterData*
 		{
-			if (Actor)
+			TRACE_CPUPROFILER_EVENT_SCOPE(FPCGGetWaterDataElement::BuildWaterData);
+			SCOPE_CYCLE_COUNTER(STAT_PCGWater_DataBuild);
+
+			UPCGWaterData* NewWaterData = NewObject<UPCGWaterData>();
+			NewWaterData->InitializeFromEntries(Group.WaterBodyEntries, Group.Bounds, true, Attributes, Settings->bApplyExclusionVolumes);
+			NewWaterData->SetQueryMode(Settings->bHeightOnly, Settings->bIncludeWaves);
+
+			if (Settings->bBakeRaster)
 			{
-				Data->AddSinglePointFromActor(Actor);
-				bHasData = true;
+				NewWaterData->BuildRaster(Settings->RasterTexelSize, static_cast<int64>(Settings->RasterMemoryBudgetMB * 1024.0 * 1024.0));
 			}
-		}
 
-		if (bHasData)
+			return NewWaterData;
+		};
+
+		if (WaterSubsystem)
+		{
+			const FPCGWaterCacheKey Key = UE::PCGWaterInterop::Private::ComputeSharedWaterDataKey(Group.WaterBodyEntries, Settings, Attributes);
+			const TStrongObjectPtr<UPCGWaterData> SharedWaterData = WaterSubsystem->FindOrBuildWaterData(Key, BuildWaterData);
+			GroupWaterData[GroupIndex] = CastChecked<UPCGWaterData>(SharedWaterData->DuplicateData());
+		}
+		else
 		{
-			FPCGTaggedData& TaggedData = InContext->OutputData.TaggedData.Emplace_GetRef();
-			TaggedData.Data = Data;
+			GroupWaterData[GroupIndex] = BuildWaterData();
 		}
+	});
+
+	for (int32 GroupIndex = 0; GroupIndex < Groups.Num(); ++GroupIndex)
+	{
+		TArray<FName, TInlineAllocator<16>>& WaterTags = Groups[GroupIndex].Tags;
+		WaterTags.Sort(FNameFastLess());
+		WaterTags.SetNum(Algo::Unique(WaterTags), /*bAllowShrinking=*/false);
+
+		UE::PCGWaterInterop::Private::OutputWaterData(InContext, Settings, GroupWaterData[GroupIndex], WaterTags);
 	}
-	else // Stripped-down version of the normal code path with bParseActor = false
+}
+
+void FPCGGetWaterDataElement::ProcessWaterSnapshot(FPCGContext* InContext, const UPCGGetWaterSettings* InSettings) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FPCGGetWaterDataElement::ProcessWaterSnapshot);
+
+	check(InContext);
+	check(InSettings);
+
+	UPCGWaterSnapshot* Snapshot = InSettings->WaterSnapshot.LoadSynchronous();
+	if (!Snapshot)
 	{
-		FPCGDataCollection DataToMerge;
-		const bool bParseActor = false;
+		PCGE_LOG_C(Error, GraphAndLog, InContext, LOCTEXT("SnapshotNotLoaded", "Could not load the water snapshot"));
+		return;
+	}
 
-		for (AActor* Actor : FoundActors)
-		{
-			if (Actor)
-			{
-				FPCGDataCollection Collection = UPCGComponent::CreateActorPCGDataCollection(Actor, InContext->SourceComponent.Get(), EPCGDataType::Any, bParseActor);
-				DataToMerge.TaggedData += Collection.TaggedData;
-			}
-		}
+	UPCGComponent* Component = InContext->SourceComponent.Get();
 
-		// Perform point data-to-point data merge
-		if (DataToMerge.TaggedData.Num() > 1)
-		{
-			UPCGMergeSettings* MergeSettings = NewObject<UPCGMergeSettings>();
-			TSharedPtr<IPCGElement> MergeElement = MergeSettings->GetElement();
-			FPCGContext* MergeContext = MergeElement->Initialize(DataToMerge, InContext->SourceComponent, nullptr);
-			MergeContext->AsyncState.NumAvailableTasks = InContext->AsyncState.NumAvailableTasks;
-			MergeContext->InputData.TaggedData.Emplace_GetRef().Data = MergeSettings;
+#if WITH_EDITOR
+	// Snapshots are rebaked by the water subsystem after water edits, or from the asset, never while a graph executes
+	if (Snapshot->NeedsRebuild() && Snapshot->HasData())
+	{
+		PCGE_LOG_C(Warning, GraphAndLog, InContext, LOCTEXT("StaleSnapshot", "The water snapshot is out of date, rebuild it from the asset"));
+	}
+#endif
 
-			while (!MergeElement->Execute(MergeContext))
-			{
-			}
+	if (!Snapshot->HasData())
+	{
+		PCGE_LOG_C(Warning, GraphAndLog, InContext, LOCTEXT("EmptySnapshot", "The water snapshot is empty"));
+		return;
+	}
 
-			InContext->OutputData = MergeContext->OutputData;
-			delete MergeContext;
-		}
-		else if (DataToMerge.TaggedData.Num() == 1)
+	FBox WaterBounds = Snapshot->GetBounds();
+	if (InSettings->ActorSelector.bMustOverlapSelf && Component)
+	{
+		WaterBounds = WaterBounds.Overlap(Component->GetGridBounds());
+	}
+
+	if (!WaterBounds.IsValid)
+	{
+		return;
+	}
+
+	TArray<FName, TInlineAllocator<16>> WaterTags;
+	for (const FPCGWaterSnapshotBody& Body : Snapshot->GetBodies())
+	{
+		if (!Body.Bounds.IsValid || Body.Bounds.Intersect(WaterBounds))
 		{
-			InContext->OutputData.TaggedData = DataToMerge.TaggedData;
+			WaterTags.Append(Body.Tags);
 		}
 	}
+
+	WaterTags.Sort(FNameFastLess());
+	WaterTags.SetNum(Algo::Unique(WaterTags), /*bAllowShrinking=*/false);
+
+	UPCGWaterData* WaterData = NewObject<UPCGWaterData>();
+	WaterData->InitializeFromSnapshot(Snapshot, WaterBounds, true, UE::PCGWaterInterop::Private::GetWaterAttributes(InSettings));
+	WaterData->SetQueryMode(InSettings->bHeightOnly, Snapshot->bIncludeWaves);
+
+	UE::PCGWaterInterop::Private::OutputWaterData(InContext, InSettings, WaterData, WaterTags);
+}
+
+void FPCGGetWaterDataElement::ProcessActor(
+	FPCGContext* InContext,
+	const UPCGDataFromActorSettings* InSettings,
+	AActor* FoundActor) const
+{
+	checkf(false, TEXT("This should never be called directly"));
 }
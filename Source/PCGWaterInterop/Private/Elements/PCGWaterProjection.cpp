@@ -0,0 +1,162 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Elements/PCGWaterProjection.h"
+
+#include "Data/PCGPointData.h"
+#include "Data/PCGWaterData.h"
+#include "PCGPin.h"
+#include "PCGWaterStats.h"
+
+#define LOCTEXT_NAMESPACE "PCGWaterProjectionElement"
+
+#if WITH_EDITOR
+FText UPCGWaterProjectionSettings::GetNodeTooltipText() const
+{
+	return LOCTEXT("WaterProjectionTooltip", "Projects the points onto the water surface, in chunks spread over several frames if needed. Points out of the water are left as they are.");
+}
+#endif
+
+TArray<FPCGPinProperties> UPCGWaterProjectionSettings::InputPinProperties() const
+{
+	TArray<FPCGPinProperties> PinProperties;
+	PinProperties.Emplace(PCGPinConstants::DefaultInputLabel, EPCGDataType::Point);
+	PinProperties.Emplace(PCGWaterProjectionConstants::WaterLabel, EPCGDataType::Surface, /*bAllowMultipleConnections=*/true, /*bAllowMultipleData=*/true);
+
+	return PinProperties;
+}
+
+TArray<FPCGPinProperties> UPCGWaterProjectionSettings::OutputPinProperties() const
+{
+	TArray<FPCGPinProperties> PinProperties;
+	PinProperties.Emplace(PCGPinConstants::DefaultOutputLabel, EPCGDataType::Point);
+
+	return PinProperties;
+}
+
+FPCGElementPtr UPCGWaterProjectionSettings::CreateElement() const
+{
+	return MakeShared<FPCGWaterProjectionElement>();
+}
+
+FPCGContext* FPCGWaterProjectionElement::Initialize(const FPCGDataCollection& InputData, TWeakObjectPtr<UPCGComponent> SourceComponent, const UPCGNode* Node)
+{
+	FPCGWaterProjectionContext* Context = new FPCGWaterProjectionContext();
+	Context->InputData = InputData;
+	Context->SourceComponent = SourceComponent;
+	Context->Node = Node;
+
+	return Context;
+}
+
+bool FPCGWaterProjectionElement::ExecuteInternal(FPCGContext* InContext) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FPCGWaterProjectionElement::Execute);
+
+	check(InContext);
+	FPCGWaterProjectionContext* Context = static_cast<FPCGWaterProjectionContext*>(InContext);
+
+	const UPCGWaterProjectionSettings* Settings = Context->GetInputSettings<UPCGWaterProjectionSettings>();
+	check(Settings);
+
+	// Points are projected onto the first water data, in pin order, that has them in water.
+	TArray<const UPCGWaterData*, TInlineAllocator<8>> WaterDatas;
+	for (const FPCGTaggedData& WaterInput : Context->InputData.GetInputsByPin(PCGWaterProjectionConstants::WaterLabel))
+	{
+		if (const UPCGWaterData* WaterData = Cast<UPCGWaterData>(WaterInput.Data))
+		{
+			WaterDatas.Add(WaterData);
+		}
+	}
+
+	if (WaterDatas.IsEmpty())
+	{
+		PCGE_LOG(Warning, GraphAndLog, LOCTEXT("NoWaterData", "No water data on the Water pin, points are passed through."));
+		Context->OutputData.TaggedData = Context->InputData.GetInputsByPin(PCGPinConstants::DefaultInputLabel);
+		return true;
+	}
+
+	const TArray<FPCGTaggedData> Inputs = Context->InputData.GetInputsByPin(PCGPinConstants::DefaultInputLabel);
+	const int32 PointsPerChunk = FMath::Max(Settings->PointsPerChunk, 1);
+
+	while (Context->InputIndex < Inputs.Num())
+	{
+		const FPCGTaggedData& Input = Inputs[Context->InputIndex];
+		const UPCGPointData* InputPointData = Cast<UPCGPointData>(Input.Data);
+
+		if (!InputPointData)
+		{
+			PCGE_LOG(Warning, GraphAndLog, LOCTEXT("InputNotPointData", "Input is not point data, skipped."));
+			++Context->InputIndex;
+			continue;
+		}
+
+		const TArray<FPCGPoint>& InputPoints = InputPointData->GetPoints();
+
+		if (!Context->OutputPointData)
+		{
+			Context->OutputPointData = NewObject<UPCGPointData>();
+			Context->OutputPointData->InitializeFromData(InputPointData);
+			Context->OutputPointData->GetMutablePoints().Reserve(InputPoints.Num());
+
+			FPCGTaggedData& Output = Context->OutputData.TaggedData.Add_GetRef(Input);
+			Output.Data = Context->OutputPointData;
+		}
+
+		// Points are copied to the output one chunk at a time and projected there, the projection scratch buffers only live for the chunk.
+		while (Context->PointCursor < InputPoints.Num())
+		{
+			const int32 NumChunkPoints = FMath::Min(PointsPerChunk, InputPoints.Num() - Context->PointCursor);
+
+			TArray<FPCGPoint>& OutputPoints = Context->OutputPointData->GetMutablePoints();
+			OutputPoints.Append(InputPoints.GetData() + Context->PointCursor, NumChunkPoints);
+
+			const TArrayView<FPCGPoint> ChunkPoints = MakeArrayView(OutputPoints.GetData() + Context->PointCursor, NumChunkPoints);
+
+			int32 NumProjected = 0;
+			if (WaterDatas.Num() == 1)
+			{
+				NumProjected = WaterDatas[0]->ProjectPoints(ChunkPoints, Settings->ProjectionParams, Context->OutputPointData->Metadata);
+			}
+			else
+			{
+				// Water data that doesn't overlap the chunk (ie. per body data) is skipped without querying it
+				FBox ChunkBounds(EForceInit::ForceInit);
+				for (const FPCGPoint& Point : ChunkPoints)
+				{
+					ChunkBounds += Point.Transform.GetLocation();
+				}
+
+				TBitArray<> Projected(false, NumChunkPoints);
+				for (const UPCGWaterData* WaterData : WaterDatas)
+				{
+					const FBox WaterBounds = WaterData->GetBounds();
+					if (!WaterBounds.IsValid || FBox2D(FVector2D(WaterBounds.Min), FVector2D(WaterBounds.Max)).Intersect(FBox2D(FVector2D(ChunkBounds.Min), FVector2D(ChunkBounds.Max))))
+					{
+						NumProjected += WaterData->ProjectPoints(ChunkPoints, Settings->ProjectionParams, Context->OutputPointData->Metadata, &Projected);
+					}
+				}
+			}
+
+			Context->PointCursor += NumChunkPoints;
+			INC_DWORD_STAT_BY(STAT_PCGWater_PointsProduced, NumProjected);
+
+			if (Context->PointCursor < InputPoints.Num() && Context->ShouldStop())
+			{
+				return false;
+			}
+		}
+
+		++Context->InputIndex;
+		Context->PointCursor = 0;
+		Context->OutputPointData = nullptr;
+
+		if (Context->InputIndex < Inputs.Num() && Context->ShouldStop())
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+#undef LOCTEXT_NAMESPACE
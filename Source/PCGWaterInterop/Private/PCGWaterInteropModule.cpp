@@ -1,6 +1,22 @@
 ﻿// Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "Modules/ModuleInterface.h"
+#include "PCGWaterStats.h"
+
+DEFINE_STAT(STAT_PCGWater_ActorDiscovery);
+DEFINE_STAT(STAT_PCGWater_DataBuild);
+DEFINE_STAT(STAT_PCGWater_SampleWaterSurface);
+DEFINE_STAT(STAT_PCGWater_CreatePointData);
+DEFINE_STAT(STAT_PCGWater_SampledLocations);
+DEFINE_STAT(STAT_PCGWater_WaterBodyQueries);
+DEFINE_STAT(STAT_PCGWater_RasterSamples);
+DEFINE_STAT(STAT_PCGWater_Hits);
+DEFINE_STAT(STAT_PCGWater_Misses);
+DEFINE_STAT(STAT_PCGWater_PointsProduced);
+DEFINE_STAT(STAT_PCGWater_SharedDataCacheHits);
+DEFINE_STAT(STAT_PCGWater_SharedDataCacheMisses);
+DEFINE_STAT(STAT_PCGWater_DistanceFieldCacheHits);
+DEFINE_STAT(STAT_PCGWater_DistanceFieldCacheMisses);
 
 class FPCGWaterInteropModule final
 	: public IModuleInterface
@@ -0,0 +1,27 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Stats/Stats.h"
+
+/**
+* Water sampling stats, shown with "stat PCGWater" and recorded in Unreal Insights along with the CPU trace scopes.
+* Counters are per frame. Water body queries over sampled locations gives the number of bodies tested per location.
+*/
+DECLARE_STATS_GROUP(TEXT("PCG Water"), STATGROUP_PCGWater, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Actor Discovery"), STAT_PCGWater_ActorDiscovery, STATGROUP_PCGWater, PCGWATERINTEROP_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Water Data Build"), STAT_PCGWater_DataBuild, STATGROUP_PCGWater, PCGWATERINTEROP_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Sample Water Surface"), STAT_PCGWater_SampleWaterSurface, STATGROUP_PCGWater, PCGWATERINTEROP_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Create Point Data"), STAT_PCGWater_CreatePointData, STATGROUP_PCGWater, PCGWATERINTEROP_API);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Sampled Locations"), STAT_PCGWater_SampledLocations, STATGROUP_PCGWater, PCGWATERINTEROP_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Water Body Queries"), STAT_PCGWater_WaterBodyQueries, STATGROUP_PCGWater, PCGWATERINTEROP_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Raster Samples"), STAT_PCGWater_RasterSamples, STATGROUP_PCGWater, PCGWATERINTEROP_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Hits"), STAT_PCGWater_Hits, STATGROUP_PCGWater, PCGWATERINTEROP_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Misses"), STAT_PCGWater_Misses, STATGROUP_PCGWater, PCGWATERINTEROP_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Points Produced"), STAT_PCGWater_PointsProduced, STATGROUP_PCGWater, PCGWATERINTEROP_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Shared Data Cache Hits"), STAT_PCGWater_SharedDataCacheHits, STATGROUP_PCGWater, PCGWATERINTEROP_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Shared Data Cache Misses"), STAT_PCGWater_SharedDataCacheMisses, STATGROUP_PCGWater, PCGWATERINTEROP_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Distance Field Cache Hits"), STAT_PCGWater_DistanceFieldCacheHits, STATGROUP_PCGWater, PCGWATERINTEROP_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Distance Field Cache Misses"), STAT_PCGWater_DistanceFieldCacheMisses, STATGROUP_PCGWater, PCGWATERINTEROP_API);
@@ -0,0 +1,732 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PCGWaterSubsystem.h"
+
+#include "Data/PCGWaterData.h"
+#include "Data/PCGWaterDistanceField.h"
+#include "Data/PCGWaterSnapshot.h"
+#include "Elements/PCGWaterGetter.h"
+#include "Helpers/PCGHelpers.h"
+#include "PCGComponent.h"
+#include "PCGGraph.h"
+#include "PCGModule.h"
+#include "PCGSubgraph.h"
+#include "PCGWaterStats.h"
+#include "WaterBodyActor.h"
+#include "WaterBodyComponent.h"
+#include "WaterSplineComponent.h"
+#include "WaterWaves.h"
+
+#include "Engine/Engine.h"
+#include "Engine/Level.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "UObject/UObjectIterator.h"
+
+namespace UE::PCGWaterInterop::Private
+{
+	// Distance fields can be large, only the most recently requested ones are kept.
+	constexpr int32 MaxCachedDistanceFields = 8;
+
+	// Water data is small next to the structures it shares, but each entry keeps its bodies' raster alive.
+	constexpr int32 MaxCachedWaterData = 16;
+
+#if WITH_EDITOR
+	// Seconds without water edits before the snapshots are rebaked, longer when the last edit was still in progress in case its end isn't reported.
+	constexpr double SnapshotRebakeDelay = 0.5;
+	constexpr double InteractiveSnapshotRebakeDelay = 2.0;
+
+	/** Which water edits a graph depends on through its Get Water Data nodes tracking water by region. */
+	enum class EWaterConsumerScope : uint8
+	{
+		None,
+		/** Edits overlapping the component's actor. */
+		Self,
+		/** Any edit. */
+		World,
+	};
+
+	/** What a graph reads through its Get Water Data nodes, subgraphs included. */
+	struct FWaterGraphUsage
+	{
+		EWaterConsumerScope Scope = EWaterConsumerScope::None;
+
+		/** Loaded snapshots read instead of the water bodies. Snapshot nodes only depend on their snapshot, not on the edits. */
+		TArray<UPCGWaterSnapshot*, TInlineAllocator<1>> Snapshots;
+
+		bool ReadsWater() const { return Scope != EWaterConsumerScope::None || !Snapshots.IsEmpty(); }
+	};
+
+	void GatherWaterGraphUsage(const UPCGGraph* InGraph, TSet<const UPCGGraph*>& InOutVisitedGraphs, FWaterGraphUsage& OutUsage)
+	{
+		if (!InGraph)
+		{
+			return;
+		}
+
+		bool bAlreadyVisited = false;
+		InOutVisitedGraphs.Add(InGraph, &bAlreadyVisited);
+		if (bAlreadyVisited)
+		{
+			return;
+		}
+
+		for (const UPCGNode* Node : InGraph->GetNodes())
+		{
+			const UPCGSettings* Settings = Node ? Node->GetSettings() : nullptr;
+
+			if (const UPCGGetWaterSettings* WaterSettings = Cast<UPCGGetWaterSettings>(Settings))
+			{
+				if (!WaterSettings->WaterSnapshot.IsNull())
+				{
+					if (UPCGWaterSnapshot* Snapshot = WaterSettings->WaterSnapshot.Get())
+					{
+						OutUsage.Snapshots.AddUnique(Snapshot);
+					}
+				}
+				else if (WaterSettings->IsTrackingWaterByRegion())
+				{
+					OutUsage.Scope = FMath::Max(OutUsage.Scope, WaterSettings->ActorSelector.bMustOverlapSelf ? EWaterConsumerScope::Self : EWaterConsumerScope::World);
+				}
+			}
+			else if (const UPCGBaseSubgraphSettings* SubgraphSettings = Cast<UPCGBaseSubgraphSettings>(Settings))
+			{
+				GatherWaterGraphUsage(SubgraphSettings->GetSubgraph(), InOutVisitedGraphs, OutUsage);
+			}
+		}
+	}
+
+	/**
+	* Calls InFunc on the components of the world whose graph reads water. Components are found from their graphs, not registered when they execute,
+	* so those served from the graph cache are found too. Partitioned graphs are found through their local components.
+	*/
+	void ForEachWaterConsumer(UWorld* InWorld, TFunctionRef<void(UPCGComponent*, const FWaterGraphUsage&)> InFunc)
+	{
+		TMap<const UPCGGraph*, FWaterGraphUsage> GraphUsages;
+
+		for (TObjectIterator<UPCGComponent> It(RF_ClassDefaultObject | RF_ArchetypeObject, /*bIncludeDerivedClasses=*/true, EInternalObjectFlags::Garbage); It; ++It)
+		{
+			UPCGComponent* Component = *It;
+			if (!Component || Component->GetWorld() != InWorld)
+			{
+				continue;
+			}
+
+			// The original component of a partitioned graph would regenerate every cell
+			if (Component->IsPartitioned() && !Component->IsLocalComponent())
+			{
+				continue;
+			}
+
+			const UPCGGraph* Graph = Component->GetGraph();
+			if (!Graph)
+			{
+				continue;
+			}
+
+			const FWaterGraphUsage* Usage = GraphUsages.Find(Graph);
+			if (!Usage)
+			{
+				FWaterGraphUsage NewUsage;
+				TSet<const UPCGGraph*> VisitedGraphs;
+				GatherWaterGraphUsage(Graph, VisitedGraphs, NewUsage);
+				Usage = &GraphUsages.Add(Graph, MoveTemp(NewUsage));
+			}
+
+			if (Usage->ReadsWater())
+			{
+				InFunc(Component, *Usage);
+			}
+		}
+	}
+#endif
+}
+
+void UPCGWaterSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	UWorld* World = GetWorld();
+	check(World);
+
+	ActorSpawnedHandle = World->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &UPCGWaterSubsystem::OnActorSpawned));
+	ActorDestroyedHandle = World->AddOnActorDestroyedHandler(FOnActorDestroyed::FDelegate::CreateUObject(this, &UPCGWaterSubsystem::OnActorDestroyed));
+	LoadedActorAddedHandle = ULevel::OnLoadedActorAddedToLevelEvent.AddWeakLambda(this, [this](AActor& InActor) { OnActorAdded(&InActor); });
+	LoadedActorRemovedHandle = ULevel::OnLoadedActorRemovedFromLevelEvent.AddWeakLambda(this, [this](AActor& InActor) { OnActorRemoved(&InActor); });
+	LevelAddedHandle = FWorldDelegates::LevelAddedToWorld.AddUObject(this, &UPCGWaterSubsystem::OnLevelAdded);
+	LevelRemovedHandle = FWorldDelegates::LevelRemovedFromWorld.AddUObject(this, &UPCGWaterSubsystem::OnLevelRemoved);
+
+#if WITH_EDITOR
+	if (GEngine)
+	{
+		ActorMovedHandle = GEngine->OnActorMoved().AddUObject(this, &UPCGWaterSubsystem::OnActorMoved);
+	}
+
+	ObjectPropertyChangedHandle = FCoreUObjectDelegates::OnObjectPropertyChanged.AddUObject(this, &UPCGWaterSubsystem::OnObjectPropertyChanged);
+#endif
+}
+
+void UPCGWaterSubsystem::Deinitialize()
+{
+	if (UWorld* World = GetWorld())
+	{
+		World->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+		World->RemoveOnActorDestroyededHandler(ActorDestroyedHandle);
+	}
+
+	ULevel::OnLoadedActorAddedToLevelEvent.Remove(LoadedActorAddedHandle);
+	ULevel::OnLoadedActorRemovedFromLevelEvent.Remove(LoadedActorRemovedHandle);
+	FWorldDelegates::LevelAddedToWorld.Remove(LevelAddedHandle);
+	FWorldDelegates::LevelRemovedFromWorld.Remove(LevelRemovedHandle);
+
+#if WITH_EDITOR
+	if (GEngine)
+	{
+		GEngine->OnActorMoved().Remove(ActorMovedHandle);
+	}
+
+	FCoreUObjectDelegates::OnObjectPropertyChanged.Remove(ObjectPropertyChangedHandle);
+
+	if (WaterEditsTickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(WaterEditsTickerHandle);
+		WaterEditsTickerHandle.Reset();
+	}
+#endif
+
+	WaterBodies.Empty();
+
+	{
+		FScopeLock Lock(&DistanceFieldsLock);
+		DistanceFields.Empty();
+	}
+
+	{
+		FScopeLock Lock(&WaterDataLock);
+		SharedWaterData.Empty();
+	}
+
+	{
+		FScopeLock Lock(&WaterBodyRevisionsLock);
+		WaterBodyRevisions.Empty();
+	}
+
+	Super::Deinitialize();
+}
+
+bool UPCGWaterSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::Editor || WorldType == EWorldType::PIE;
+}
+
+UPCGWaterSubsystem* UPCGWaterSubsystem::GetInstance(UWorld* World)
+{
+	return World ? World->GetSubsystem<UPCGWaterSubsystem>() : nullptr;
+}
+
+void UPCGWaterSubsystem::ForEachWaterBody(const FBox& InBounds, TFunctionRef<bool(AActor*)> InFunc)
+{
+	check(IsInGameThread());
+	TRACE_CPUPROFILER_EVENT_SCOPE(UPCGWaterSubsystem::ForEachWaterBody);
+
+	UpdateIndex();
+
+	if (!InBounds.IsValid)
+	{
+		for (const TWeakObjectPtr<AWaterBody>& WaterBody : WaterBodies)
+		{
+			if (WaterBody.IsValid() && !InFunc(WaterBody.Get()))
+			{
+				return;
+			}
+		}
+
+		return;
+	}
+
+	TArray<int32> OverlappingBodies;
+	WaterBodyIndex.GetOverlappingBodies(FBox2D(FVector2D(InBounds.Min), FVector2D(InBounds.Max)), OverlappingBodies);
+
+	for (int32 BodyIndex : OverlappingBodies)
+	{
+		if (WaterBodies[BodyIndex].IsValid() && !InFunc(WaterBodies[BodyIndex].Get()))
+		{
+			return;
+		}
+	}
+}
+
+TSharedPtr<const FPCGWaterDistanceField> UPCGWaterSubsystem::FindOrBuildDistanceField(const FPCGWaterCacheKey& InKey, TFunctionRef<TSharedPtr<const FPCGWaterDistanceField>()> InBuildFunc)
+{
+	TSharedFuture<TSharedPtr<const FPCGWaterDistanceField>> Future;
+	TOptional<TPromise<TSharedPtr<const FPCGWaterDistanceField>>> Promise;
+
+	{
+		FScopeLock Lock(&DistanceFieldsLock);
+
+		const int32 FoundIndex = DistanceFields.IndexOfByPredicate([&InKey](const TPair<FPCGWaterCacheKey, TSharedFuture<TSharedPtr<const FPCGWaterDistanceField>>>& Entry) { return Entry.Key == InKey; });
+		if (FoundIndex != INDEX_NONE)
+		{
+			Future = DistanceFields[FoundIndex].Value;
+			INC_DWORD_STAT(STAT_PCGWater_DistanceFieldCacheHits);
+		}
+		else if (IsCurrent(InKey))
+		{
+			INC_DWORD_STAT(STAT_PCGWater_DistanceFieldCacheMisses);
+			Promise.Emplace();
+			Future = Promise->GetFuture().Share();
+
+			if (DistanceFields.Num() >= UE::PCGWaterInterop::Private::MaxCachedDistanceFields)
+			{
+				DistanceFields.RemoveAt(0);
+			}
+
+			DistanceFields.Emplace(InKey, Future);
+		}
+	}
+
+	// Water edited since it was read would cache a stale field, the result is only handed to this request.
+	if (!Future.IsValid())
+	{
+		INC_DWORD_STAT(STAT_PCGWater_DistanceFieldCacheMisses);
+		return InBuildFunc();
+	}
+
+	// Built outside of the lock, other requests for this key wait on the future.
+	if (Promise.IsSet())
+	{
+		Promise->SetValue(InBuildFunc());
+	}
+
+	return Future.Get();
+}
+
+TStrongObjectPtr<UPCGWaterData> UPCGWaterSubsystem::FindOrBuildWaterData(const FPCGWaterCacheKey& InKey, TFunctionRef<UPCGWaterData*()> InBuildFunc)
+{
+	TSharedFuture<TStrongObjectPtr<UPCGWaterData>> Future;
+	TOptional<TPromise<TStrongObjectPtr<UPCGWaterData>>> Promise;
+
+	{
+		FScopeLock Lock(&WaterDataLock);
+
+		const int32 FoundIndex = SharedWaterData.IndexOfByPredicate([&InKey](const TPair<FPCGWaterCacheKey, TSharedFuture<TStrongObjectPtr<UPCGWaterData>>>& Entry) { return Entry.Key == InKey; });
+		if (FoundIndex != INDEX_NONE)
+		{
+			Future = SharedWaterData[FoundIndex].Value;
+			INC_DWORD_STAT(STAT_PCGWater_SharedDataCacheHits);
+		}
+		else if (IsCurrent(InKey))
+		{
+			INC_DWORD_STAT(STAT_PCGWater_SharedDataCacheMisses);
+			Promise.Emplace();
+			Future = Promise->GetFuture().Share();
+
+			// Requests still waiting on an evicted entry hold its future, which keeps the data alive for them.
+			if (SharedWaterData.Num() >= UE::PCGWaterInterop::Private::MaxCachedWaterData)
+			{
+				SharedWaterData.RemoveAt(0);
+			}
+
+			SharedWaterData.Emplace(InKey, Future);
+		}
+	}
+
+	// Bodies edited since they were read would cache stale water, the result is only handed to this request.
+	if (!Future.IsValid())
+	{
+		INC_DWORD_STAT(STAT_PCGWater_SharedDataCacheMisses);
+		return TStrongObjectPtr<UPCGWaterData>(InBuildFunc());
+	}
+
+	// Built outside of the lock, other requests for this key wait on the future.
+	if (Promise.IsSet())
+	{
+		Promise->SetValue(TStrongObjectPtr<UPCGWaterData>(InBuildFunc()));
+	}
+
+	return Future.Get();
+}
+
+uint32 UPCGWaterSubsystem::GetWaterBodyRevision(const FSoftObjectPath& InWaterBody) const
+{
+	FScopeLock Lock(&WaterBodyRevisionsLock);
+	const uint32* Revision = WaterBodyRevisions.Find(InWaterBody);
+	return Revision ? *Revision : 0;
+}
+
+bool UPCGWaterSubsystem::IsCurrent(const FPCGWaterCacheKey& InKey) const
+{
+	check(InKey.WaterBodies.Num() == InKey.WaterBodyRevisions.Num());
+
+	FScopeLock Lock(&WaterBodyRevisionsLock);
+	for (int32 Index = 0; Index < InKey.WaterBodies.Num(); ++Index)
+	{
+		const uint32* Revision = WaterBodyRevisions.Find(InKey.WaterBodies[Index]);
+		if ((Revision ? *Revision : 0) != InKey.WaterBodyRevisions[Index])
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void UPCGWaterSubsystem::RegisterWaterBody(AWaterBody* InWaterBody)
+{
+	if (InWaterBody && InWaterBody->GetWorld() == GetWorld())
+	{
+		// A body loaded again replaces the actor that structures cached from its previous load read
+		WaterBodies.AddUnique(InWaterBody);
+		MarkWaterBodyDirty(InWaterBody);
+
+#if WITH_EDITOR
+		LastWaterBodyBounds.Add(InWaterBody, PCGHelpers::GetGridBounds(InWaterBody, nullptr));
+#endif
+	}
+}
+
+void UPCGWaterSubsystem::UnregisterWaterBody(AWaterBody* InWaterBody)
+{
+	if (WaterBodies.Remove(InWaterBody) > 0)
+	{
+		MarkWaterBodyDirty(InWaterBody);
+
+#if WITH_EDITOR
+		LastWaterBodyBounds.Remove(InWaterBody);
+#endif
+	}
+}
+
+void UPCGWaterSubsystem::RegisterLevel(ULevel* InLevel)
+{
+	if (!InLevel)
+	{
+		return;
+	}
+
+	for (AActor* Actor : InLevel->Actors)
+	{
+		RegisterWaterBody(Cast<AWaterBody>(Actor));
+	}
+}
+
+void UPCGWaterSubsystem::UpdateIndex()
+{
+	// Bodies present before the subsystem started listening are gathered once, on first use.
+	if (!bRegisteredExistingWaterBodies)
+	{
+		bRegisteredExistingWaterBodies = true;
+
+		for (TActorIterator<AWaterBody> It(GetWorld()); It; ++It)
+		{
+			RegisterWaterBody(*It);
+		}
+	}
+
+	if (!bIndexDirty)
+	{
+		return;
+	}
+
+	WaterBodies.RemoveAll([](const TWeakObjectPtr<AWaterBody>& WaterBody) { return !WaterBody.IsValid(); });
+
+	TArray<FBox> WaterBodyBounds;
+	WaterBodyBounds.Reserve(WaterBodies.Num());
+	for (const TWeakObjectPtr<AWaterBody>& WaterBody : WaterBodies)
+	{
+		WaterBodyBounds.Add(PCGHelpers::GetGridBounds(WaterBody.Get(), nullptr));
+	}
+
+	WaterBodyIndex.Build(WaterBodyBounds);
+	bIndexDirty = false;
+}
+
+void UPCGWaterSubsystem::MarkWaterBodyDirty(const AWaterBody* InWaterBody)
+{
+	bIndexDirty = true;
+
+	if (!InWaterBody)
+	{
+		return;
+	}
+
+	const FSoftObjectPath WaterBodyPath(InWaterBody);
+
+	// Bumped before the entries are dropped, so builds that started before this edit can't be cached once the lock below is released.
+	{
+		FScopeLock Lock(&WaterBodyRevisionsLock);
+		++WaterBodyRevisions.FindOrAdd(WaterBodyPath, 0);
+	}
+
+	{
+		FScopeLock Lock(&DistanceFieldsLock);
+		DistanceFields.RemoveAll([&WaterBodyPath](const TPair<FPCGWaterCacheKey, TSharedFuture<TSharedPtr<const FPCGWaterDistanceField>>>& Entry) { return Entry.Key.ReferencesWaterBody(WaterBodyPath); });
+	}
+
+	{
+		FScopeLock Lock(&WaterDataLock);
+		SharedWaterData.RemoveAll([&WaterBodyPath](const TPair<FPCGWaterCacheKey, TSharedFuture<TStrongObjectPtr<UPCGWaterData>>>& Entry) { return Entry.Key.ReferencesWaterBody(WaterBodyPath); });
+	}
+}
+
+void UPCGWaterSubsystem::OnActorAdded(AActor* InActor)
+{
+	RegisterWaterBody(Cast<AWaterBody>(InActor));
+}
+
+void UPCGWaterSubsystem::OnActorRemoved(AActor* InActor)
+{
+	UnregisterWaterBody(Cast<AWaterBody>(InActor));
+}
+
+void UPCGWaterSubsystem::OnActorSpawned(AActor* InActor)
+{
+	OnActorAdded(InActor);
+
+#if WITH_EDITOR
+	if (AWaterBody* WaterBody = Cast<AWaterBody>(InActor))
+	{
+		OnWaterBodyEdited(WaterBody);
+	}
+#endif
+}
+
+void UPCGWaterSubsystem::OnActorDestroyed(AActor* InActor)
+{
+#if WITH_EDITOR
+	if (AWaterBody* WaterBody = Cast<AWaterBody>(InActor))
+	{
+		OnWaterBodyEdited(WaterBody);
+	}
+#endif
+
+	OnActorRemoved(InActor);
+}
+
+void UPCGWaterSubsystem::OnLevelAdded(ULevel* InLevel, UWorld* InWorld)
+{
+	if (InWorld == GetWorld())
+	{
+		RegisterLevel(InLevel);
+	}
+}
+
+void UPCGWaterSubsystem::OnLevelRemoved(ULevel* InLevel, UWorld* InWorld)
+{
+	if (InWorld == GetWorld())
+	{
+		WaterBodies.RemoveAll([this, InLevel](const TWeakObjectPtr<AWaterBody>& WaterBody)
+		{
+			if (!WaterBody.IsValid())
+			{
+				bIndexDirty = true;
+				return true;
+			}
+
+			if (!InLevel || WaterBody->GetLevel() == InLevel)
+			{
+				MarkWaterBodyDirty(WaterBody.Get());
+				return true;
+			}
+
+			return false;
+		});
+	}
+}
+
+#if WITH_EDITOR
+void UPCGWaterSubsystem::OnWaterSnapshotRebuilt(const UPCGWaterSnapshot* InSnapshot)
+{
+	check(IsInGameThread());
+
+	if (InSnapshot)
+	{
+		RefreshWaterConsumers(FBox(EForceInit::ForceInit), MakeArrayView(&InSnapshot, 1));
+	}
+}
+
+void UPCGWaterSubsystem::OnActorMoved(AActor* InActor)
+{
+	if (AWaterBody* WaterBody = Cast<AWaterBody>(InActor))
+	{
+		MarkWaterBodyDirty(WaterBody);
+		OnWaterBodyEdited(WaterBody);
+	}
+}
+
+void UPCGWaterSubsystem::OnObjectPropertyChanged(UObject* InObject, FPropertyChangedEvent& InEvent)
+{
+	if (!InObject)
+	{
+		return;
+	}
+
+	// Every property edit of the editor goes through here, anything that isn't a water body, one of its water components or waves is rejected before any work.
+	// Spline and shape edits change the water body bounds.
+	AWaterBody* WaterBody = Cast<AWaterBody>(InObject);
+	if (!WaterBody && (InObject->IsA<UWaterBodyComponent>() || InObject->IsA<UWaterSplineComponent>()))
+	{
+		WaterBody = Cast<AWaterBody>(CastChecked<UActorComponent>(InObject)->GetOwner());
+	}
+
+	const bool bInteractive = InEvent.ChangeType == EPropertyChangeType::Interactive;
+
+	if (WaterBody)
+	{
+		MarkWaterBodyDirty(WaterBody);
+		OnWaterBodyEdited(WaterBody, bInteractive);
+		return;
+	}
+
+	const bool bIsWaves = InObject->IsA<UWaterWavesBase>() || InObject->IsA<UWaterWavesAsset>() || InObject->GetTypedOuter<UWaterWavesAsset>() || InObject->GetTypedOuter<UWaterWavesBase>();
+	if (!bIsWaves)
+	{
+		return;
+	}
+
+	// Wave assets are shared, every body using the edited one is dirty.
+	UpdateIndex();
+
+	for (const TWeakObjectPtr<AWaterBody>& WaterBodyPtr : WaterBodies)
+	{
+		AWaterBody* Body = WaterBodyPtr.Get();
+		const UWaterWavesBase* WaterWaves = Body ? Body->GetWaterWaves() : nullptr;
+		if (!WaterWaves)
+		{
+			continue;
+		}
+
+		const UWaterWavesAssetReference* WavesReference = Cast<UWaterWavesAssetReference>(WaterWaves);
+		const UObject* WavesSource = WavesReference ? static_cast<const UObject*>(WavesReference->GetWaterWavesAsset()) : WaterWaves;
+
+		if (WavesSource && (InObject == WavesSource || InObject->IsIn(WavesSource)))
+		{
+			MarkWaterBodyDirty(Body);
+			OnWaterBodyEdited(Body, bInteractive);
+		}
+	}
+}
+
+void UPCGWaterSubsystem::OnWaterBodyEdited(AWaterBody* InWaterBody, bool bInInteractive)
+{
+	check(InWaterBody);
+
+	const FBox NewBounds = PCGHelpers::GetGridBounds(InWaterBody, nullptr);
+	FBox& LastBounds = LastWaterBodyBounds.FindOrAdd(InWaterBody, FBox(EForceInit::ForceInit));
+
+	FBox DirtyBounds = NewBounds;
+	if (LastBounds.IsValid)
+	{
+		DirtyBounds += LastBounds;
+	}
+
+	LastBounds = NewBounds;
+
+	if (DirtyBounds.IsValid)
+	{
+		PendingDirtyBounds += DirtyBounds;
+		PendingSnapshotBounds += DirtyBounds;
+	}
+
+	PendingSnapshotBodies.AddUnique(FSoftObjectPath(InWaterBody));
+	LastWaterEditTime = FPlatformTime::Seconds();
+	bLastWaterEditInteractive = bInInteractive;
+
+	// Edits are processed on the next tick, once for every edit made in between (ie. while dragging a spline point).
+	if (!WaterEditsTickerHandle.IsValid())
+	{
+		WaterEditsTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &UPCGWaterSubsystem::ProcessWaterEdits));
+	}
+}
+
+bool UPCGWaterSubsystem::ProcessWaterEdits(float InDeltaTime)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UPCGWaterSubsystem::ProcessWaterEdits);
+
+	UWorld* World = GetWorld();
+
+	// Components reading the water by region are refreshed every tick with edits, they only regenerate the cells touched by the edits.
+	if (PendingDirtyBounds.IsValid)
+	{
+		const FBox DirtyBounds = PendingDirtyBounds;
+		PendingDirtyBounds = FBox(EForceInit::ForceInit);
+		RefreshWaterConsumers(DirtyBounds, {});
+	}
+
+	// Snapshots are full bakes, they are only rebaked once the edits settle rather than on every intermediate change.
+	const double RebakeDelay = bLastWaterEditInteractive ? UE::PCGWaterInterop::Private::InteractiveSnapshotRebakeDelay : UE::PCGWaterInterop::Private::SnapshotRebakeDelay;
+	if (FPlatformTime::Seconds() - LastWaterEditTime < RebakeDelay)
+	{
+		return true;
+	}
+
+	WaterEditsTickerHandle.Reset();
+
+	const TArray<FSoftObjectPath> EditedBodies = MoveTemp(PendingSnapshotBodies);
+	const FBox EditedBounds = PendingSnapshotBounds;
+	PendingSnapshotBodies.Reset();
+	PendingSnapshotBounds = FBox(EForceInit::ForceInit);
+
+	// Only the snapshots read in this world and touched by the edits are rebaked. Bodies being loaded or unloaded don't go through here, only edits do.
+	TArray<UPCGWaterSnapshot*> Snapshots;
+	UE::PCGWaterInterop::Private::ForEachWaterConsumer(World, [&Snapshots, &EditedBodies, &EditedBounds](UPCGComponent* InComponent, const UE::PCGWaterInterop::Private::FWaterGraphUsage& InUsage)
+	{
+		for (UPCGWaterSnapshot* Snapshot : InUsage.Snapshots)
+		{
+			if (!Snapshots.Contains(Snapshot) && Snapshot->IsAffectedByWaterEdit(EditedBodies, EditedBounds))
+			{
+				Snapshots.Add(Snapshot);
+			}
+		}
+	});
+
+	TArray<const UPCGWaterSnapshot*> RebuiltSnapshots;
+	for (UPCGWaterSnapshot* Snapshot : Snapshots)
+	{
+		Snapshot->MarkStale();
+
+		if (Snapshot->CanRebuildFromLoadedWater(World))
+		{
+			Snapshot->Rebuild(World);
+			RebuiltSnapshots.Add(Snapshot);
+		}
+		else
+		{
+			UE_LOG(LogPCG, Warning, TEXT("UPCGWaterSubsystem: '%s' was not rebuilt after a water edit, some of its water bodies aren't loaded. Rebuild it from the asset once they are."), *Snapshot->GetPathName());
+		}
+	}
+
+	if (!RebuiltSnapshots.IsEmpty())
+	{
+		RefreshWaterConsumers(FBox(EForceInit::ForceInit), RebuiltSnapshots);
+	}
+
+	return false;
+}
+
+void UPCGWaterSubsystem::RefreshWaterConsumers(const FBox& InDirtyBounds, TConstArrayView<const UPCGWaterSnapshot*> InRebuiltSnapshots)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UPCGWaterSubsystem::RefreshWaterConsumers);
+
+	UE::PCGWaterInterop::Private::ForEachWaterConsumer(GetWorld(), [&InDirtyBounds, InRebuiltSnapshots](UPCGComponent* InComponent, const UE::PCGWaterInterop::Private::FWaterGraphUsage& InUsage)
+	{
+		using UE::PCGWaterInterop::Private::EWaterConsumerScope;
+
+		bool bRefresh = InUsage.Snapshots.ContainsByPredicate([InRebuiltSnapshots](const UPCGWaterSnapshot* InSnapshot) { return InRebuiltSnapshots.Contains(InSnapshot); });
+
+		// Consumers that don't overlap the edit keep their generated result.
+		if (!bRefresh && InDirtyBounds.IsValid && InUsage.Scope != EWaterConsumerScope::None)
+		{
+			const AActor* Owner = InComponent->GetOwner();
+			const FBox ConsumerBounds = (Owner && InUsage.Scope == EWaterConsumerScope::Self) ? PCGHelpers::GetActorBounds(Owner) : FBox(EForceInit::ForceInit);
+			bRefresh = !ConsumerBounds.IsValid || ConsumerBounds.Intersect(InDirtyBounds);
+		}
+
+		if (bRefresh)
+		{
+			InComponent->DirtyGenerated(EPCGComponentDirtyFlag::Actor);
+			InComponent->Refresh();
+		}
+	});
+}
+#endif
@@ -0,0 +1,42 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+
+#include "PCGWaterBenchmarkCommandlet.generated.h"
+
+class AWaterBody;
+
+/**
+* Times water data sampling against a synthetic world of lakes, rivers and optionally an ocean, and reports points/sec and memory.
+* Runs headless, ie: UnrealEditor-Cmd <Project> -run=PCGWaterBenchmark -Points=10000,1000000 -Bodies=1,100,1000 [-Ocean] [-Csv=<Path>]
+*/
+UCLASS()
+class PCGWATERINTEROP_API UPCGWaterBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UPCGWaterBenchmarkCommandlet();
+
+	//~ Begin UCommandlet Interface
+	virtual int32 Main(const FString& Params) override;
+	//~ End UCommandlet Interface
+
+private:
+	struct FResult
+	{
+		FString Name;
+		int32 NumBodies = 0;
+		int32 NumPoints = 0;
+		int32 NumHits = 0;
+		double Seconds = 0.0;
+		int64 UsedPhysicalDelta = 0;
+		uint64 PeakUsedPhysical = 0;
+	};
+
+	void RunBenchmarks(UWorld* World, int32 NumBodies, TConstArrayView<int32> PointCounts, bool bWithOcean, TArray<FResult>& OutResults) const;
+	void SpawnWaterBodies(UWorld* World, int32 NumBodies, bool bWithOcean, TArray<TWeakObjectPtr<AWaterBody>>& OutWaterBodies, FBox& OutBounds) const;
+	FResult RunGetWaterDataElement(UWorld* World, int32 NumBodies) const;
+};
@@ -0,0 +1,62 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+* Uniform 2D grid over the XY bounds of a set of water bodies, used to find which bodies can contain a given location
+* without testing all of them. Bodies are referred to by their index in the array passed to Build, and are always
+* visited in increasing index order, so the first hit is the same as with a linear walk over all bodies.
+*/
+class PCGWATERINTEROP_API FPCGWaterBodyIndex
+{
+public:
+	/** Invalid boxes are considered unbounded: these bodies are candidates for every location. */
+	void Build(TConstArrayView<FBox> InBodyBounds);
+
+	bool IsEmpty() const { return NumBodies == 0; }
+	int32 GetNumBodies() const { return NumBodies; }
+
+	/** Calls InFunc(BodyIndex) for every body whose bounds contain the location, in increasing index order, until InFunc returns true. Returns true if a call returned true. */
+	template<typename FuncType>
+	bool ForEachCandidate(const FVector& InLocation, FuncType&& InFunc) const
+	{
+		const FVector2D Location(InLocation);
+		for (int32 BodyIndex : GetCellBodies(Location))
+		{
+			if (BodyBounds[BodyIndex].IsInside(Location) && InFunc(BodyIndex))
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	/** Gathers the bodies whose XY bounds overlap the box, in increasing index order. */
+	void GetOverlappingBodies(const FBox2D& InBox, TArray<int32>& OutBodies) const;
+
+	/** Returns true if the XY bounds of any body, bounded or not, overlap the box. */
+	bool HasBodyOverlapping(const FBox2D& InBox) const;
+
+private:
+	TConstArrayView<int32> GetCellBodies(const FVector2D& InLocation) const;
+	void GetCellRange(const FBox2D& InBox, FIntPoint& OutMin, FIntPoint& OutMax) const;
+
+	int32 NumBodies = 0;
+
+	/** XY bounds per body, unbounded bodies get a box that contains everything. */
+	TArray<FBox2D> BodyBounds;
+
+	/** Bodies that are candidates everywhere, also used for locations outside of the grid. */
+	TArray<int32> UnboundedBodies;
+
+	FBox2D GridBounds = FBox2D(EForceInit::ForceInit);
+	FVector2D InvCellSize = FVector2D::ZeroVector;
+	FIntPoint GridSize = FIntPoint::ZeroValue;
+
+	/** Per-cell ranges in CellBodies, CellStarts[CellIndex] to CellStarts[CellIndex + 1]. */
+	TArray<int32> CellStarts;
+	TArray<int32> CellBodies;
+};
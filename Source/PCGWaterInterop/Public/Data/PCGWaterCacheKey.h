@@ -0,0 +1,100 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/SoftObjectPath.h"
+
+#include <type_traits>
+
+/**
+* Key of a structure cached by the water subsystem: the water bodies it was built from, at which revision, and the settings it was built with.
+* Keys are compared in full on lookup, so structures built for other water are never handed out on a hash collision.
+*/
+struct FPCGWaterCacheKey
+{
+	/** Water bodies the structure reads, in the order it reads them if that matters. */
+	TArray<FSoftObjectPath> WaterBodies;
+
+	/** Revision of each water body when it was read, indexed like WaterBodies, see UPCGWaterSubsystem::GetWaterBodyRevision. */
+	TArray<uint32> WaterBodyRevisions;
+
+	/** Settings the structure was built with, as raw bytes. */
+	TArray<uint8, TInlineAllocator<64>> Settings;
+
+	void AddWaterBody(const FSoftObjectPath& InWaterBody, uint32 InRevision)
+	{
+		WaterBodies.Add(InWaterBody);
+		WaterBodyRevisions.Add(InRevision);
+	}
+
+	/** Sorts the water bodies, for structures that don't depend on the order they read them. */
+	void SortWaterBodies()
+	{
+		TArray<int32> Order;
+		Order.Reserve(WaterBodies.Num());
+		for (int32 Index = 0; Index < WaterBodies.Num(); ++Index)
+		{
+			Order.Add(Index);
+		}
+
+		Order.Sort([this](int32 A, int32 B) { return WaterBodies[A].LexicalLess(WaterBodies[B]); });
+
+		TArray<FSoftObjectPath> SortedWaterBodies;
+		TArray<uint32> SortedRevisions;
+		SortedWaterBodies.Reserve(Order.Num());
+		SortedRevisions.Reserve(Order.Num());
+		for (int32 Index : Order)
+		{
+			SortedWaterBodies.Add(MoveTemp(WaterBodies[Index]));
+			SortedRevisions.Add(WaterBodyRevisions[Index]);
+		}
+
+		WaterBodies = MoveTemp(SortedWaterBodies);
+		WaterBodyRevisions = MoveTemp(SortedRevisions);
+	}
+
+	/** Appends a setting. Only scalars, whose bytes can be compared. */
+	template<typename T>
+	void AddSetting(T InValue)
+	{
+		static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>, "Settings are compared as bytes, only scalars are supported");
+		Settings.Append(reinterpret_cast<const uint8*>(&InValue), sizeof(T));
+	}
+
+	void AddSetting(const FVector& InValue)
+	{
+		AddSetting(InValue.X);
+		AddSetting(InValue.Y);
+		AddSetting(InValue.Z);
+	}
+
+	void AddSetting(const FBox& InValue)
+	{
+		AddSetting(InValue.Min);
+		AddSetting(InValue.Max);
+		AddSetting(static_cast<bool>(InValue.IsValid));
+	}
+
+	void AddSetting(const FGuid& InValue)
+	{
+		AddSetting(InValue.A);
+		AddSetting(InValue.B);
+		AddSetting(InValue.C);
+		AddSetting(InValue.D);
+	}
+
+	void AddSetting(const FSoftObjectPath& InValue)
+	{
+		const FString Path = InValue.ToString();
+		AddSetting(Path.Len());
+		Settings.Append(reinterpret_cast<const uint8*>(*Path), Path.Len() * sizeof(TCHAR));
+	}
+
+	bool ReferencesWaterBody(const FSoftObjectPath& InWaterBody) const { return WaterBodies.Contains(InWaterBody); }
+
+	bool operator==(const FPCGWaterCacheKey& Other) const
+	{
+		return Settings == Other.Settings && WaterBodyRevisions == Other.WaterBodyRevisions && WaterBodies == Other.WaterBodies;
+	}
+};
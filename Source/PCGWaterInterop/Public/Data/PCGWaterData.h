@@ -3,11 +3,104 @@
 #pragma once
 
 #include "Data/PCGSurfaceData.h"
+#include "UObject/ObjectKey.h"
+#include "WaterBodyTypes.h"
 
 #include "PCGWaterData.generated.h"
 
+class FPCGWaterBodyIndex;
+class FPCGWaterExclusionVolumes;
+class FPCGWaterRaster;
+class FPCGWaterWaveKernel;
 class UPCGWaterCache;
+class UPCGWaterSnapshot;
 class AWaterBody;
+class UWaterBodyComponent;
+
+/** Per-point attributes written by the water data, each one can be switched off so graphs only pay for what they read. */
+UENUM(meta = (Bitflags, UseEnumValuesAsMaskValuesInEditor = "true"))
+enum class EPCGWaterAttributes : uint8
+{
+	None = 0 UMETA(Hidden),
+	/** Name attribute with the type of the water body (River, Lake, Ocean...). */
+	WaterBodyType = 1 << 0,
+	/** Float attribute with the immersion depth below the water surface. */
+	Depth = 1 << 1,
+	/** Vector attribute with the water velocity at the surface. */
+	Velocity = 1 << 2,
+	/** Name attribute with the actor tags of the water body, comma separated. */
+	WaterTags = 1 << 3,
+};
+ENUM_CLASS_FLAGS(EPCGWaterAttributes);
+
+namespace PCGWaterDataConstants
+{
+	const FName WaterBodyTypeAttribute = TEXT("WaterBodyType");
+	const FName DepthAttribute = TEXT("WaterDepth");
+	const FName VelocityAttribute = TEXT("WaterVelocity");
+	const FName WaterTagsAttribute = TEXT("WaterTags");
+}
+
+/** Exclusion volume of a water body, as resolved from its actor. */
+struct FPCGWaterExclusionVolume
+{
+	/** Identifies volumes shared by several bodies. */
+	FObjectKey Volume;
+
+	FBox Bounds = FBox(EForceInit::ForceInit);
+};
+
+/**
+* Transient state of a water body, resolved once from its actor on the game thread, see UPCGWaterData::ResolveWaterBodies.
+* The water data only reads this afterwards, so it can be built on worker threads while the water is edited.
+*/
+struct FPCGWaterBodyEntry
+{
+	TSoftObjectPtr<AWaterBody> WaterBody;
+
+	/** Revision of the body in the water subsystem when it was resolved, structures built from this entry are keyed on it. See UPCGWaterSubsystem::GetWaterBodyRevision. */
+	uint32 Revision = 0;
+
+	TWeakObjectPtr<const UWaterBodyComponent> Component;
+
+	FTransform Transform = FTransform::Identity;
+
+	/** Invalid for bodies that can answer queries anywhere (ie. oceans). */
+	FBox Bounds = FBox(EForceInit::ForceInit);
+
+	/** Grid bounds of the actor, used to find the partition cells the body overlaps. */
+	FBox GridBounds = FBox(EForceInit::ForceInit);
+
+	EWaterBodyType Type = EWaterBodyType::Transition;
+
+	TArray<FName> ActorTags;
+
+	/** Actor tags of the water body, comma separated, for the WaterTags attribute. */
+	FName Tags;
+
+	/** Only resolved when the exclusion volumes are applied. */
+	TArray<FPCGWaterExclusionVolume> ExclusionVolumes;
+
+	/** Vectorized waves of the body, used by batched queries. Null if the body has no waves the kernel supports. */
+	TSharedPtr<const FPCGWaterWaveKernel> WaveKernel;
+};
+
+/** Result of a water surface query at a single location. */
+struct FPCGWaterSurfaceSample
+{
+	FVector Location = FVector::ZeroVector;
+	FVector Normal = FVector::UpVector;
+	float ImmersionDepth = 0.0f;
+
+	/** Only computed when the Velocity attribute is written. */
+	FVector Velocity = FVector::ZeroVector;
+
+	/** Index of the water body in UPCGWaterData::WaterBodies, INDEX_NONE if the location isn't in water. */
+	int32 WaterBodyIndex = INDEX_NONE;
+
+	bool IsInWater() const { return WaterBodyIndex != INDEX_NONE; }
+};
+
 /**
 * Water data access abstraction for PCG. Supports multi-waterbody access, but it assumes that they are not overlapping.
 */
@@ -17,7 +110,26 @@ class PCGWATERINTEROP_API UPCGWaterData : public UPCGSurfaceData
 	GENERATED_BODY()
 
 public:
-	void Initialize(const TArray<TWeakObjectPtr<AWaterBody>>& InWaterBodies, const FBox& InBounds, bool bInUseMetadata);
+	/** Resolves the water bodies and initializes from them, so it must run on the game thread. See InitializeFromEntries. */
+	void Initialize(const TArray<TWeakObjectPtr<AWaterBody>>& InWaterBodies, const FBox& InBounds, bool bInUseMetadata, EPCGWaterAttributes InAttributes = EPCGWaterAttributes::WaterBodyType | EPCGWaterAttributes::Depth, bool bInApplyExclusionVolumes = false);
+
+	/**
+	* Initializes from resolved water bodies. Only reads the entries, never the actors, so it can run on any thread.
+	* With bInApplyExclusionVolumes, the exclusion volumes of the bodies are indexed once here and locations inside them aren't in water for the excluded bodies.
+	*/
+	void InitializeFromEntries(TArray<FPCGWaterBodyEntry> InEntries, const FBox& InBounds, bool bInUseMetadata, EPCGWaterAttributes InAttributes = EPCGWaterAttributes::WaterBodyType | EPCGWaterAttributes::Depth, bool bInApplyExclusionVolumes = false);
+
+	/**
+	* Resolves the state of the valid water bodies from their actors, in the order of InWaterBodies. Called on the game thread, which captures the actor state
+	* and then waits while the per-body work (bounds, tags, wave kernels) runs in parallel. Exclusion volumes are only gathered with bInResolveExclusionVolumes.
+	*/
+	static TArray<FPCGWaterBodyEntry> ResolveWaterBodies(TConstArrayView<TWeakObjectPtr<AWaterBody>> InWaterBodies, bool bInResolveExclusionVolumes);
+
+	/**
+	* Initializes from a baked snapshot instead of the water body actors, which don't have to be loaded. Queries inside the snapshot are answered
+	* from its raster, locations outside of it aren't in water.
+	*/
+	void InitializeFromSnapshot(const UPCGWaterSnapshot* InSnapshot, const FBox& InBounds, bool bInUseMetadata, EPCGWaterAttributes InAttributes = EPCGWaterAttributes::WaterBodyType | EPCGWaterAttributes::Depth);
 
 	// ~Begin UPCGData interface
 	virtual EPCGDataType GetDataType() const override { return EPCGDataType::Surface; }
@@ -36,7 +148,7 @@ protected:
 
 public:
 	// ~Begin UPCGSpatialDataWithPointCache interface
-	virtual bool SupportsBoundedPointData() const { return true; }
+	virtual bool SupportsBoundedPointData() const override { return true; }
 	virtual const UPCGPointData* CreatePointData(FPCGContext* Context) const override { return CreatePointData(Context, FBox(EForceInit::ForceInit)); }
 	virtual const UPCGPointData* CreatePointData(FPCGContext* Context, const FBox& InBounds) const override;
 	// ~End UPCGSpatialDataWithPointCache interface
@@ -44,15 +156,116 @@ public:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = SourceData)
 	TArray<TSoftObjectPtr<AWaterBody>> WaterBodies;
 
+	/** Distance between the points generated when converting this data to point data. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = SourceData, meta = (ClampMin = "1.0"))
+	float PointSpacing = 100.0f;
+
+	/**
+	* Coarser levels point generation starts from, 0 samples every point. With N levels the water is first sampled every 2^N points, then only the blocks
+	* whose corners differ in water state, water body or depth are refined. Points of the other blocks are interpolated from their corners.
+	* Water narrower than the coarsest spacing can be missed.
+	*/
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = SourceData, meta = (ClampMin = "0", ClampMax = "8"))
+	int32 AdaptiveSamplingLevels = 0;
+
+	/** Largest immersion depth difference between the corners of a block for its points to be interpolated rather than sampled. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = SourceData, meta = (ClampMin = "0.0"))
+	float AdaptiveDepthTolerance = 10.0f;
+
 	bool IsUsingMetadata() const { return bUseMetadata; }
 
+	/** Attributes written on the points, none if the data doesn't use metadata. */
+	EPCGWaterAttributes GetAttributes() const { return bUseMetadata ? Attributes : EPCGWaterAttributes::None; }
+
+	/** In height only mode, queries only compute the water height and points only have their location and density changed. Waves are optional. */
+	void SetQueryMode(bool bInHeightOnly, bool bInIncludeWaves);
+	bool IsHeightOnly() const { return bHeightOnly; }
+	bool IsIncludingWaves() const { return bIncludeWaves; }
+
+	/**
+	* Batched ProjectPoint, projects the points in place. Points that aren't in water are left untouched. Returns the number of points in water.
+	* Attributes are created in OutMetadata if needed, and the metadata entries of the points in water are allocated in one go.
+	* If InOutProjected is set, points it flags are skipped and the points projected here are flagged, so several water data can project the same points.
+	*/
+	int32 ProjectPoints(TArrayView<FPCGPoint> InOutPoints, const FPCGProjectionParams& InParams, UPCGMetadata* OutMetadata, TBitArray<>* InOutProjected = nullptr) const;
+
+	/** Batched SamplePoint, samples the points in place against their own bounds. OutSampled tells which points are valid. Returns the number of valid points. Attributes are written like in ProjectPoints. */
+	int32 SamplePoints(TArrayView<FPCGPoint> InOutPoints, TBitArray<>& OutSampled, UPCGMetadata* OutMetadata) const;
+
+	/**
+	* Queries the water surface for a batch of locations. Queries are grouped per water body rather than done location by location.
+	* For bodies with Gerstner waves, the bodies are queried for the still water surface and the waves are evaluated 4 locations at a time,
+	* so locations above the still water surface aren't reported as in water even under a wave crest. The single location query does the same.
+	*/
+	void SampleWaterSurface(TConstArrayView<FVector> InLocations, TArrayView<FPCGWaterSurfaceSample> OutSamples) const;
+
+	/** Queries the water surface at a single location, in the first water body containing it, with the same results as the batched query. Returns false if the location isn't in water. */
+	bool SampleWaterSurface(const FVector& InLocation, FPCGWaterSurfaceSample& OutSample) const;
+
+	/** Bakes the water surface over the bounds, after which queries inside the bounds are answered from the raster instead of the water bodies. */
+	void BuildRaster(double InTexelSize, int64 InMemoryBudget);
+
+	bool HasRaster() const { return Raster.IsValid(); }
+
+	/** Texel size of the baked surface, 0 if there is none. */
+	double GetRasterTexelSize() const;
+
+	/** Resolved water bodies, indexed like WaterBodies. */
+	TConstArrayView<FPCGWaterBodyEntry> GetWaterBodyEntries() const { return WaterBodyEntries; }
+
+	/** Snapshot this data was initialized from, null if it reads the water bodies. */
+	const UPCGWaterSnapshot* GetSnapshot() const { return Snapshot.Get(); }
+
+	bool IsApplyingExclusionVolumes() const { return ExclusionVolumes.IsValid(); }
+
 protected:
+	EWaterBodyQueryFlags GetQueryFlags() const;
+	const UWaterBodyComponent* GetWaterBodyComponent(int32 InWaterBodyIndex) const;
+
+	/** Returns true if the location is in an exclusion volume of the water body, see Initialize. */
+	bool IsExcluded(const FVector& InLocation, int32 InWaterBodyIndex) const;
+
+	/**
+	* Writes the attributes of the points in water, allocating their metadata entries in one go. Samples are indexed like the points.
+	* Attributes missing from OutMetadata are created only if bInCreateAttributes is set, which isn't safe while other threads write to the metadata.
+	*/
+	void WriteAttributes(TArrayView<FPCGPoint> InOutPoints, TConstArrayView<FPCGWaterSurfaceSample> InSamples, UPCGMetadata* OutMetadata, bool bInCreateAttributes) const;
+
+	/**
+	* Coarse to fine sampling of the grid cells from InCellMin to InCellMax included, see AdaptiveSamplingLevels.
+	* Blocks for which InIsBlockCulled, given their min and max cells, returns true can't contain water and are neither sampled nor refined.
+	* Outputs the cells in water and their sampled or interpolated samples, in row-major order.
+	*/
+	void SampleGridAdaptive(const FIntPoint& InCellMin, const FIntPoint& InCellMax, double InSpacing, double InSampleZ, TFunctionRef<bool(const FIntPoint&, const FIntPoint&)> InIsBlockCulled, TArray<FIntPoint>& OutCells, TArray<FPCGWaterSurfaceSample>& OutSamples) const;
+
 	UPROPERTY()
 	FBox Bounds = FBox(EForceInit::ForceInit);
 
 	UPROPERTY()
 	bool bHeightOnly = false;
 
+	UPROPERTY()
+	bool bIncludeWaves = true;
+
 	UPROPERTY()
 	bool bUseMetadata = true;
+
+	UPROPERTY()
+	EPCGWaterAttributes Attributes = EPCGWaterAttributes::None;
+
+	/** Resolved water bodies, indexed like WaterBodies which stays the persistent form. Built on Initialize, copied with the data. */
+	TArray<FPCGWaterBodyEntry> WaterBodyEntries;
+
+	/** Snapshot this data was initialized from, if any. Its bodies are never resolved to actors. */
+	UPROPERTY()
+	TObjectPtr<const UPCGWaterSnapshot> Snapshot;
+
+	/** Spatial index over the water bodies XY bounds, built on Initialize and shared between copies. */
+	TSharedPtr<const FPCGWaterBodyIndex> BodyIndex;
+
+	/** Exclusion volumes of the water bodies, null if they aren't applied or there are none. Built on Initialize and shared between copies. */
+	TSharedPtr<const FPCGWaterExclusionVolumes> ExclusionVolumes;
+
+	/** Optional baked surface, see BuildRaster. Shared between copies. */
+	TSharedPtr<const FPCGWaterRaster> Raster;
 };
@@ -0,0 +1,41 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Data/PCGWaterCacheKey.h"
+
+class UPCGWaterData;
+
+/**
+* Signed distance to the water over a 2D region, positive on land and negative in water, in world units.
+* Built from the water data's in-water mask with an exact separable Euclidean distance transform, then looked up with bilinear filtering.
+* Distances are clamped to the max distance given when building, as are lookups outside of the region.
+*/
+class PCGWATERINTEROP_API FPCGWaterDistanceField
+{
+public:
+	/**
+	* Samples the water data at the center of every texel of InBounds, from the bottom of the bounds, then computes the distances.
+	* The texel size is increased until the field fits in the memory budget.
+	*/
+	void Build(const UPCGWaterData* InWaterData, const FBox& InBounds, double InTexelSize, int64 InMemoryBudget, double InMaxDistance);
+
+	float GetSignedDistance(const FVector& InLocation) const;
+
+	double GetTexelSize() const { return TexelSize; }
+	double GetMaxDistance() const { return MaxDistance; }
+	SIZE_T GetAllocatedSize() const { return Distances.GetAllocatedSize(); }
+
+	/** Key identifying the field built for this water data and parameters, so data over the same water bodies (ie. partition cells) can share it. */
+	static FPCGWaterCacheKey ComputeKey(const UPCGWaterData* InWaterData, const FBox& InBounds, double InTexelSize, double InMaxDistance);
+
+private:
+	FVector2D Origin = FVector2D::ZeroVector;
+	double TexelSize = 0.0;
+	double MaxDistance = 0.0;
+	FIntPoint NumTexels = FIntPoint::ZeroValue;
+
+	/** Row major signed distances at texel centers. */
+	TArray<float> Distances;
+};
@@ -0,0 +1,39 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Data/PCGWaterBodyIndex.h"
+
+#include "Algo/BinarySearch.h"
+
+struct FPCGWaterBodyEntry;
+
+/**
+* Water exclusion volumes of a set of water bodies, indexed on their XY bounds so a location is only tested against the volumes around it.
+* Volumes are approximated by the XY footprint of their bounds. Bodies are referred to by their index in the entries passed to Build.
+*/
+class PCGWATERINTEROP_API FPCGWaterExclusionVolumes
+{
+public:
+	/** Indexes the resolved exclusion volumes of every body, volumes shared by several bodies are only indexed once. */
+	void Build(TConstArrayView<FPCGWaterBodyEntry> InWaterBodyEntries);
+
+	bool IsEmpty() const { return ExcludedBodies.IsEmpty(); }
+
+	/** Returns true if the location is inside an exclusion volume of the water body. */
+	bool IsExcluded(const FVector& InLocation, int32 InWaterBodyIndex) const
+	{
+		return VolumeIndex.ForEachCandidate(InLocation, [this, InWaterBodyIndex](int32 InVolumeIndex)
+		{
+			return Algo::BinarySearch(ExcludedBodies[InVolumeIndex], InWaterBodyIndex) != INDEX_NONE;
+		});
+	}
+
+private:
+	/** The body index works on any set of bounds, here the bounds of the volumes. */
+	FPCGWaterBodyIndex VolumeIndex;
+
+	/** Sorted indices of the water bodies each volume excludes. */
+	TArray<TArray<int32>> ExcludedBodies;
+};
@@ -0,0 +1,64 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FPCGWaterSurfaceSample;
+
+/**
+* Baked water surface over a 2D region: surface height, normal and owning water body, stored in square tiles.
+* Tiles that can't contain water are not allocated. Each tile stores its border samples so bilinear lookups never cross tiles.
+*/
+class PCGWATERINTEROP_API FPCGWaterRaster
+{
+public:
+	/** Number of texels per tile side, tiles hold (TileSize + 1)^2 samples. */
+	static constexpr int32 TileSize = 64;
+	static constexpr int32 TileSamples = TileSize + 1;
+
+	using FSampleFunc = TFunctionRef<void(TConstArrayView<FVector>, TArrayView<FPCGWaterSurfaceSample>)>;
+	using FTileFilterFunc = TFunctionRef<bool(const FBox2D&)>;
+
+	/**
+	* Bakes the raster over InBounds by querying InSampleFunc from the bottom of the bounds, one tile at a time and in parallel.
+	* InTileFilterFunc returns false for tiles that can't contain water. The texel size is increased until the raster fits in the memory budget.
+	* Velocities are only stored if bInBakeVelocity is set, otherwise lookups report a zero velocity.
+	*/
+	void Build(const FBox& InBounds, double InTexelSize, int64 InMemoryBudget, bool bInBakeVelocity, FSampleFunc InSampleFunc, FTileFilterFunc InTileFilterFunc);
+
+	/** Returns true if the location is inside the baked region, in which case Sample is authoritative. */
+	bool Contains(const FVector& InLocation) const;
+
+	/** Bilinear lookup of the baked surface. Immersion depth is relative to the location height. Returns false if the location isn't in water. */
+	bool Sample(const FVector& InLocation, FPCGWaterSurfaceSample& OutSample) const;
+
+	/** Saves or loads the baked tiles, tiles are stored as flat arrays so they load with bulk reads. */
+	void Serialize(FArchive& Ar);
+
+	double GetTexelSize() const { return TexelSize; }
+	SIZE_T GetAllocatedSize() const;
+
+	/** Bytes used by one allocated tile. */
+	static constexpr int64 GetTileMemorySize(bool bWithVelocity) { return static_cast<int64>(TileSamples) * TileSamples * (sizeof(float) + sizeof(FVector3f) + sizeof(int32) + (bWithVelocity ? sizeof(FVector3f) : 0)); }
+
+private:
+	struct FTile
+	{
+		TArray<float> Heights;
+		TArray<FVector3f> Normals;
+		TArray<int32> WaterBodyIndices;
+
+		/** Empty if velocities aren't baked. */
+		TArray<FVector3f> Velocities;
+	};
+
+	FVector2D Origin = FVector2D::ZeroVector;
+	FVector2D Extent = FVector2D::ZeroVector;
+	double TexelSize = 0.0;
+	FIntPoint NumTiles = FIntPoint::ZeroValue;
+
+	/** Index in Tiles per tile coordinate, INDEX_NONE for tiles without water. */
+	TArray<int32> TileIndices;
+	TArray<FTile> Tiles;
+};
@@ -0,0 +1,124 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "UObject/Object.h"
+#include "WaterBodyTypes.h"
+
+#include "PCGWaterSnapshot.generated.h"
+
+class AWaterBody;
+class FPCGWaterRaster;
+class UWorld;
+
+/** Metadata of a water body baked in a snapshot, enough to write the water attributes and tags without loading the body. */
+USTRUCT()
+struct PCGWATERINTEROP_API FPCGWaterSnapshotBody
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, Category = Snapshot)
+	TSoftObjectPtr<AWaterBody> WaterBody;
+
+	/** Invalid for bodies that answer queries anywhere (ie. oceans). */
+	UPROPERTY(VisibleAnywhere, Category = Snapshot)
+	FBox Bounds = FBox(EForceInit::ForceInit);
+
+	UPROPERTY(VisibleAnywhere, Category = Snapshot)
+	EWaterBodyType Type = EWaterBodyType::Transition;
+
+	UPROPERTY(VisibleAnywhere, Category = Snapshot)
+	TArray<FName> Tags;
+};
+
+/**
+* Baked water surface of a world, saved as an asset: the raster tiles of the surface and the metadata of the bodies.
+* Water data initialized from a snapshot answers queries without the water body actors, so graphs don't need to stream water in.
+* In editor, the snapshot is rebaked once edits of its water bodies settle in a world whose graphs read it, unless some of its bodies aren't loaded,
+* and can be rebaked from the editor world with Rebuild From Editor World.
+*/
+UCLASS(BlueprintType)
+class PCGWATERINTEROP_API UPCGWaterSnapshot : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	//~Begin UObject interface
+	virtual void Serialize(FArchive& Ar) override;
+	virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
+	//~End UObject interface
+
+#if WITH_EDITOR
+	/** Bakes the snapshot from the water bodies currently registered in the world, and marks the asset dirty. */
+	void Rebuild(UWorld* InWorld);
+
+	/** Bakes the snapshot from the water of the editor world and refreshes the components reading it. Bodies that aren't loaded are left out. */
+	UFUNCTION(CallInEditor, Category = Snapshot)
+	void RebuildFromEditorWorld();
+
+	/**
+	* False if rebuilding from the loaded water would drop baked bodies, ie. in a partitioned world where some of them aren't loaded.
+	* Automatic rebakes are skipped then.
+	*/
+	bool CanRebuildFromLoadedWater(const UWorld* InWorld) const;
+
+	/** True if the snapshot has one of the water bodies baked in, or if its bounds overlap the box. */
+	bool IsAffectedByWaterEdit(TConstArrayView<FSoftObjectPath> InWaterBodies, const FBox& InBounds) const;
+
+	/** Called when the water the snapshot was baked from changes. */
+	void MarkStale() { bStale = true; }
+
+	bool NeedsRebuild() const { return bStale || !Raster.IsValid(); }
+#endif
+
+	bool HasData() const { return Raster.IsValid() && !Bodies.IsEmpty(); }
+
+	const FBox& GetBounds() const { return Bounds; }
+	const FTransform& GetTransform() const { return Transform; }
+	TConstArrayView<FPCGWaterSnapshotBody> GetBodies() const { return Bodies; }
+	TSharedPtr<const FPCGWaterRaster> GetRaster() const { return Raster; }
+
+	/** Changes with every bake, so results cached from an earlier bake aren't reused. */
+	const FGuid& GetBakeGuid() const { return BakeGuid; }
+
+	/** Distance between the baked samples. Increased if the snapshot doesn't fit in the memory budget. */
+	UPROPERTY(EditAnywhere, Category = Snapshot, meta = (ClampMin = "1.0"))
+	float TexelSize = 100.0f;
+
+	/** Maximum size of the baked surface, in megabytes. */
+	UPROPERTY(EditAnywhere, Category = Snapshot, meta = (ClampMin = "1.0"))
+	float MemoryBudgetMB = 64.0f;
+
+	/** Bake the waves, at their reference time, in the surface height and normal. */
+	UPROPERTY(EditAnywhere, Category = Snapshot)
+	bool bIncludeWaves = true;
+
+	/** Bake the water velocity, otherwise the WaterVelocity attribute is zero for data using this snapshot. */
+	UPROPERTY(EditAnywhere, Category = Snapshot)
+	bool bBakeVelocity = false;
+
+	/** Leave the water inside exclusion volumes out of the snapshot. */
+	UPROPERTY(EditAnywhere, Category = Snapshot)
+	bool bApplyExclusionVolumes = false;
+
+private:
+	/** Baked bodies, indexed like the water body indices of the raster. */
+	UPROPERTY(VisibleAnywhere, Category = "Snapshot|Content")
+	TArray<FPCGWaterSnapshotBody> Bodies;
+
+	UPROPERTY(VisibleAnywhere, Category = "Snapshot|Content")
+	FBox Bounds = FBox(EForceInit::ForceInit);
+
+	UPROPERTY()
+	FTransform Transform = FTransform::Identity;
+
+	UPROPERTY(VisibleAnywhere, Category = "Snapshot|Content")
+	FGuid BakeGuid;
+
+	/** Serialized after the properties, see Serialize. */
+	TSharedPtr<FPCGWaterRaster> Raster;
+
+#if WITH_EDITORONLY_DATA
+	bool bStale = false;
+#endif
+};
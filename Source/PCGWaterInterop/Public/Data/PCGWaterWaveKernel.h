@@ -0,0 +1,43 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UWaterBodyComponent;
+
+/**
+* Gerstner waves of a single water body, stored per parameter so a batch of positions can be evaluated 4 at a time with vector registers.
+* Only Gerstner waves are supported, other wave types are left to the water body query.
+*/
+class PCGWATERINTEROP_API FPCGWaterWaveKernel
+{
+public:
+	/** Gathers the waves of the component. Returns false if it has no waves the kernel can evaluate. */
+	bool Initialize(const UWaterBodyComponent* InComponent);
+
+	bool IsValid() const { return !Amplitudes.IsEmpty(); }
+
+	/**
+	* Evaluates the wave height offset, and the wave normal if OutNormals isn't empty, at the XY of each position, at the given wave time.
+	* Like the water body queries, the horizontal displacement of the waves is inverted so the result is at the position rather than at the undisplaced sample.
+	*/
+	void Evaluate(TConstArrayView<FVector> InPositions, float InTime, TArrayView<float> OutHeights, TArrayView<FVector> OutNormals) const;
+
+private:
+	TArray<float> WaveVectorsX;
+	TArray<float> WaveVectorsY;
+	TArray<float> DirectionsX;
+	TArray<float> DirectionsY;
+	TArray<float> Amplitudes;
+	TArray<float> WaveSpeeds;
+
+	/** Horizontal displacement amplitude. */
+	TArray<float> Qs;
+
+	/** Wave number times amplitude, slope of the height. */
+	TArray<float> WKAs;
+
+	/** Wave number times horizontal displacement amplitude, slope of the displacement. */
+	TArray<float> QKs;
+};
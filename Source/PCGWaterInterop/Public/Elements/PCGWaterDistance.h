@@ -0,0 +1,70 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "PCGSettings.h"
+
+#include "PCGWaterDistance.generated.h"
+
+namespace PCGWaterDistanceConstants
+{
+	const FName WaterLabel = TEXT("Water");
+}
+
+/**
+* Computes the signed distance from the input points to the water shoreline: positive on land, negative in water.
+* The distance field is built once over the water data bounds, and shared by all the partition cells over the same water.
+*/
+UCLASS(BlueprintType, ClassGroup = (Procedural))
+class PCGWATERINTEROP_API UPCGWaterDistanceSettings : public UPCGSettings
+{
+	GENERATED_BODY()
+
+public:
+	//~Begin UPCGSettings interface
+#if WITH_EDITOR
+	virtual FName GetDefaultNodeName() const override { return FName(TEXT("WaterDistance")); }
+	virtual FText GetDefaultNodeTitle() const override { return NSLOCTEXT("PCGWaterDistanceSettings", "NodeTitle", "Water Distance"); }
+	virtual FText GetNodeTooltipText() const override;
+	virtual EPCGSettingsType GetType() const override { return EPCGSettingsType::Spatial; }
+#endif
+
+protected:
+	virtual TArray<FPCGPinProperties> InputPinProperties() const override;
+	virtual TArray<FPCGPinProperties> OutputPinProperties() const override;
+	virtual FPCGElementPtr CreateElement() const override;
+	//~End UPCGSettings
+
+public:
+	/** Size of a distance field texel, in world units. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (PCG_Overridable, ClampMin = "1.0"))
+	float TexelSize = 200.0f;
+
+	/** Distances are clamped to this value. The field covers the water bounds extended by it. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (PCG_Overridable, ClampMin = "0.0"))
+	float MaxDistance = 10000.0f;
+
+	/** Maximum memory used while building the distance field, in megabytes. The texel size is increased until the field fits. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (PCG_Overridable, ClampMin = "1.0"))
+	float MemoryBudgetMB = 64.0f;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (PCG_Overridable))
+	bool bOutputToAttribute = true;
+
+	/** Float attribute receiving the signed distance. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (PCG_Overridable, EditCondition = "bOutputToAttribute"))
+	FName AttributeName = TEXT("WaterDistance");
+
+	/** Sets the point density from the distance to the shore, on either side: 1 on the shore, down to 0 at the falloff distance. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (PCG_Overridable))
+	bool bOutputToDensity = false;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (PCG_Overridable, EditCondition = "bOutputToDensity", ClampMin = "1.0"))
+	float DensityFalloffDistance = 1000.0f;
+};
+
+class FPCGWaterDistanceElement : public FSimplePCGElement
+{
+protected:
+	virtual bool ExecuteInternal(FPCGContext* Context) const override;
+};
@@ -2,11 +2,27 @@
 
 #pragma once
 
+#include "Data/PCGWaterData.h"
 #include "Elements/PCGDataFromActor.h"
 #include "UObject/Object.h"
 
 #include "PCGWaterGetter.generated.h"
 
+class AWaterBody;
+class UPCGWaterSnapshot;
+
+/** How the found water bodies are split into water data. */
+UENUM()
+enum class EPCGWaterOutputMode : uint8
+{
+	/** A single water data over all the water bodies. */
+	Combined,
+	/** One water data per water body, bounded by it. */
+	PerBody,
+	/** One water data per type of water body (Ocean, Lake, River, Transition), tagged with the type. */
+	PerBodyType,
+};
+
 /** Builds a collection of water data from the selected actors. */
 UCLASS(BlueprintType, ClassGroup = (Procedural))
 class PCGWATERINTEROP_API UPCGGetWaterSettings : public UPCGDataFromActorSettings
@@ -21,6 +37,7 @@ public:
 	virtual FName GetDefaultNodeName() const override { return FName(TEXT("GetWaterData")); }
 	virtual FText GetDefaultNodeTitle() const override { return NSLOCTEXT("PCGGetWaterSettings", "NodeTitle", "Get Water Data"); }
 	virtual FText GetNodeTooltipText() const override;
+	virtual void GetTrackedActorKeys(FPCGSelectionKeyToSettingsMap& OutKeysToSettings, TArray<TObjectPtr<const UPCGGraph>>& OutVisitedGraphs) const override;
 #endif
 
 	virtual FName AdditionalTaskName() const override;
@@ -35,6 +52,97 @@ public:
 	virtual EPCGDataType GetDataFilter() const override { return EPCGDataType::Surface; }
 	virtual TSubclassOf<AActor> GetDefaultActorSelectorClass() const override;
 	//~End UPCGDataFromActorSettings
+
+#if WITH_EDITOR
+	/** True if water edits are tracked by the water subsystem, per region, rather than by the generic actor tracking. */
+	bool IsTrackingWaterByRegion() const;
+#endif
+
+	/**
+	* Split the water bodies into several water data, each bounded by its own bodies and tagged with their tags, so downstream nodes can cull
+	* or filter the water they don't need. Snapshots are always output as a single water data.
+	*/
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (PCG_Overridable))
+	EPCGWaterOutputMode OutputMode = EPCGWaterOutputMode::Combined;
+
+	/** Distance between the points generated when the water data is converted to point data. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (PCG_Overridable, ClampMin = "1.0"))
+	float PointSpacing = 100.0f;
+
+	/**
+	* Point generation first samples the water every 2^N points, then only refines where the water state, body or depth changes, interpolating elsewhere.
+	* 0 samples every point. Best suited to shoreline placement, water narrower than the coarsest spacing can be missed.
+	*/
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (PCG_Overridable, ClampMin = "0", ClampMax = "8"))
+	int32 AdaptiveSamplingLevels = 0;
+
+	/** Largest depth difference, in world units, across a block of points for them to be interpolated rather than sampled. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (PCG_Overridable, EditCondition = "AdaptiveSamplingLevels > 0", ClampMin = "0.0"))
+	float AdaptiveDepthTolerance = 10.0f;
+
+	/** Only query the water height: points are moved to the water surface but keep their rotation and scale. Skips the surface normal computation. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (PCG_Overridable))
+	bool bHeightOnly = false;
+
+	/** Include the waves in the water height and normal. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (PCG_Overridable))
+	bool bIncludeWaves = true;
+
+	/** Locations inside a water exclusion volume aren't in water for the bodies the volume excludes. Volumes are tested by their XY bounds. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (PCG_Overridable))
+	bool bApplyExclusionVolumes = false;
+
+	/** Write the type of the water body (River, Lake, Ocean...) to the WaterBodyType attribute. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|Attributes", meta = (PCG_Overridable))
+	bool bOutputWaterBodyType = true;
+
+	/** Write the immersion depth to the WaterDepth attribute. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|Attributes", meta = (PCG_Overridable))
+	bool bOutputDepth = true;
+
+	/** Write the water velocity to the WaterVelocity attribute. Adds a velocity computation to every water query. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|Attributes", meta = (PCG_Overridable))
+	bool bOutputVelocity = false;
+
+	/** Write the actor tags of the water body to the WaterTags attribute, comma separated. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|Attributes", meta = (PCG_Overridable))
+	bool bOutputWaterTags = false;
+
+	/** Bakes the water surface into a raster when the data is created, so sampling and projection become a few memory reads instead of water body queries. Trades precision for speed. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|Raster", meta = (PCG_Overridable))
+	bool bBakeRaster = false;
+
+	/** Size of a raster texel, in world units. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|Raster", meta = (PCG_Overridable, EditCondition = "bBakeRaster", ClampMin = "1.0"))
+	float RasterTexelSize = 100.0f;
+
+	/** Maximum memory used by the raster, in megabytes. The texel size is increased until the raster fits. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|Raster", meta = (PCG_Overridable, EditCondition = "bBakeRaster", ClampMin = "1.0"))
+	float RasterMemoryBudgetMB = 256.0f;
+
+	/**
+	* Read the water from this snapshot instead of the water body actors, which then don't have to be loaded. The actor selection is ignored, the snapshot
+	* is only clipped to the component bounds if the actors must overlap it. In editor, the snapshot is rebaked once edits of its water bodies settle.
+	*/
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|Snapshot")
+	TSoftObjectPtr<UPCGWaterSnapshot> WaterSnapshot;
+
+#if WITH_EDITORONLY_DATA
+	/**
+	* When gathering all world water bodies, only regenerate the components (or partition cells) overlapping the area touched by a water edit,
+	* instead of every component using this node.
+	*/
+	UPROPERTY(EditAnywhere, Category = "Settings|Tracking")
+	bool bRefreshOnlyDirtyRegions = true;
+#endif
+};
+
+struct FPCGGetWaterDataContext : public FPCGDataFromActorContext
+{
+	/** Water bodies resolved on the main thread, the water data is then built from them on a worker thread without reading the actors. */
+	TArray<FPCGWaterBodyEntry> WaterBodyEntries;
+
+	bool bGatheredWaterBodies = false;
 };
 
 // @note: this is largely copied from FPCGDataFromActorElement, which isn't exported (as of UE 5.3)
@@ -42,14 +150,20 @@ class FPCGGetWaterDataElement : public IPCGElement
 {
 public:
 	virtual FPCGContext* Initialize(const FPCGDataCollection& InputData, TWeakObjectPtr<UPCGComponent> SourceComponent, const UPCGNode* Node) override;
-	virtual bool CanExecuteOnlyOnMainThread(FPCGContext* Context) const override { return true; }
-	virtual bool IsCacheable(const UPCGSettings* InSettings) const override { return false; }
+	/** Only the actor discovery needs the main thread, building the water data does not. */
+	virtual bool CanExecuteOnlyOnMainThread(FPCGContext* Context) const override;
+	virtual bool IsCacheable(const UPCGSettings* InSettings) const override { return true; }
+	/**
+	* Game thread only, like the graph executor calls it: it goes through the world's water bodies and loads the snapshot. Hashes the water bodies through their
+	* revisions in the water subsystem (see UPCGWaterSubsystem::GetWaterBodyRevision), or the snapshot's bake.
+	*/
+	virtual void GetDependenciesCrc(const FPCGDataCollection& InInput, const UPCGSettings* InSettings, UPCGComponent* InComponent, FPCGCrc& OutCrc) const override;
 	
 protected:
 	virtual bool ExecuteInternal(FPCGContext* Context) const override;
 	void GatherWaitTasks(AActor* FoundActor, FPCGContext* Context, TArray<FPCGTaskId>& OutWaitTasks) const;
-	virtual void ProcessActors(FPCGContext* Context, const UPCGDataFromActorSettings* Settings, const TArray<AActor*>& FoundActors) const;
+	void GatherWaterBodies(FPCGGetWaterDataContext* Context) const;
+	virtual void ProcessWaterBodies(FPCGContext* Context, const UPCGDataFromActorSettings* Settings, TConstArrayView<FPCGWaterBodyEntry> WaterBodyEntries) const;
+	void ProcessWaterSnapshot(FPCGContext* Context, const UPCGGetWaterSettings* Settings) const;
 	virtual void ProcessActor(FPCGContext* InContext, const UPCGDataFromActorSettings* Settings, AActor* FoundActor) const;
-
-	void MergeActorsIntoPointData(FPCGContext* InContext, const UPCGDataFromActorSettings* InSettings, const TArray<AActor*>& FoundActors) const;
 };
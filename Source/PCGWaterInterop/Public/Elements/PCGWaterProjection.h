@@ -0,0 +1,68 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Data/PCGProjectionData.h"
+#include "PCGContext.h"
+#include "PCGSettings.h"
+
+#include "PCGWaterProjection.generated.h"
+
+class UPCGPointData;
+
+namespace PCGWaterProjectionConstants
+{
+	const FName WaterLabel = TEXT("Water");
+}
+
+/**
+* Projects the input points onto the water surface, chunk by chunk. The node yields between chunks when its frame time budget is spent,
+* so very large point sets don't stall the editor, and only the scratch buffers of one chunk are alive at a time.
+*/
+UCLASS(BlueprintType, ClassGroup = (Procedural))
+class PCGWATERINTEROP_API UPCGWaterProjectionSettings : public UPCGSettings
+{
+	GENERATED_BODY()
+
+public:
+	//~Begin UPCGSettings interface
+#if WITH_EDITOR
+	virtual FName GetDefaultNodeName() const override { return FName(TEXT("WaterProjection")); }
+	virtual FText GetDefaultNodeTitle() const override { return NSLOCTEXT("PCGWaterProjectionSettings", "NodeTitle", "Water Projection"); }
+	virtual FText GetNodeTooltipText() const override;
+	virtual EPCGSettingsType GetType() const override { return EPCGSettingsType::Spatial; }
+#endif
+
+protected:
+	virtual TArray<FPCGPinProperties> InputPinProperties() const override;
+	virtual TArray<FPCGPinProperties> OutputPinProperties() const override;
+	virtual FPCGElementPtr CreateElement() const override;
+	//~End UPCGSettings
+
+public:
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (PCG_Overridable))
+	FPCGProjectionParams ProjectionParams;
+
+	/** Points projected between two checks of the time budget. Smaller chunks yield sooner, larger ones have less overhead. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (PCG_Overridable, ClampMin = "1"))
+	int32 PointsPerChunk = 65536;
+};
+
+struct FPCGWaterProjectionContext : public FPCGContext
+{
+	/** Input being projected, and the next of its points to project. */
+	int32 InputIndex = 0;
+	int32 PointCursor = 0;
+
+	/** Output of the input being projected, already added to the output data so it is kept alive across executions. */
+	UPCGPointData* OutputPointData = nullptr;
+};
+
+class FPCGWaterProjectionElement : public IPCGElement
+{
+public:
+	virtual FPCGContext* Initialize(const FPCGDataCollection& InputData, TWeakObjectPtr<UPCGComponent> SourceComponent, const UPCGNode* Node) override;
+
+protected:
+	virtual bool ExecuteInternal(FPCGContext* Context) const override;
+};
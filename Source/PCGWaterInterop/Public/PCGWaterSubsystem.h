@@ -0,0 +1,166 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Subsystems/WorldSubsystem.h"
+
+#include "Async/Future.h"
+#include "Containers/Ticker.h"
+#include "UObject/StrongObjectPtr.h"
+#include "Data/PCGWaterBodyIndex.h"
+#include "Data/PCGWaterCacheKey.h"
+
+#include "PCGWaterSubsystem.generated.h"
+
+class AWaterBody;
+class FPCGWaterDistanceField;
+class UPCGComponent;
+class UPCGWaterData;
+class UPCGWaterSnapshot;
+
+/**
+* Keeps track of the water bodies in a world as they are spawned, loaded, unloaded or destroyed,
+* with a spatial index of their grid bounds, so water nodes don't have to go through every actor of the world.
+* Only meant to be used from the game thread.
+* The index is refreshed when bodies are added or removed and, in editor, when they are edited. Bodies moved at runtime keep their indexed bounds,
+* water is expected to stay in place outside of the editor.
+*/
+UCLASS()
+class PCGWATERINTEROP_API UPCGWaterSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem Interface.
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	//~ End USubsystem Interface
+
+	//~ Begin UWorldSubsystem Interface.
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	//~ End UWorldSubsystem Interface
+
+	static UPCGWaterSubsystem* GetInstance(UWorld* World);
+
+	/** Calls InFunc on the registered water bodies whose grid bounds overlap the box, or on all of them if the box is invalid, until it returns false. */
+	void ForEachWaterBody(const FBox& InBounds, TFunctionRef<bool(AActor*)> InFunc);
+
+	/**
+	* Returns the distance field cached under InKey, building it with InBuildFunc if it isn't. Callers asking for a field that is being built wait for it,
+	* so partition cells over the same water build it once. Safe to call from any thread. Cached fields are dropped when one of their water bodies changes,
+	* and fields keyed on older revisions of their bodies are built for the caller only.
+	*/
+	TSharedPtr<const FPCGWaterDistanceField> FindOrBuildDistanceField(const FPCGWaterCacheKey& InKey, TFunctionRef<TSharedPtr<const FPCGWaterDistanceField>()> InBuildFunc);
+
+	/**
+	* Returns the water data cached under InKey, building it with InBuildFunc if it isn't. Partition cells finding the same water bodies share it,
+	* and only make cheap copies of it instead of building their own. Safe to call from any thread. Cached data is dropped when one of its water bodies changes,
+	* and data keyed on older revisions of its bodies is built for the caller only. The returned reference keeps it alive until the caller is done with it.
+	*/
+	TStrongObjectPtr<UPCGWaterData> FindOrBuildWaterData(const FPCGWaterCacheKey& InKey, TFunctionRef<UPCGWaterData*()> InBuildFunc);
+
+	/**
+	* Revision of the water body, bumped every time it is added, removed or edited. Structures built from a body are keyed on the revision it was read at,
+	* and only cached while it is current, so a build started before an edit is never handed out after it. 0 for bodies never registered. Safe to call from any thread.
+	*/
+	uint32 GetWaterBodyRevision(const FSoftObjectPath& InWaterBody) const;
+
+#if WITH_EDITOR
+	/** Refreshes the components of this world reading the snapshot, after it was rebuilt outside of a water edit. */
+	void OnWaterSnapshotRebuilt(const UPCGWaterSnapshot* InSnapshot);
+#endif
+
+private:
+	void RegisterWaterBody(AWaterBody* InWaterBody);
+	void UnregisterWaterBody(AWaterBody* InWaterBody);
+	void RegisterLevel(ULevel* InLevel);
+	void UpdateIndex();
+
+	/**
+	* Called when a water body is added, removed or edited. Bumps its revision and drops the cached structures reading it, bodies streaming elsewhere
+	* don't affect the others.
+	*/
+	void MarkWaterBodyDirty(const AWaterBody* InWaterBody);
+
+	/** Returns true if the key reads the current revision of all its water bodies. */
+	bool IsCurrent(const FPCGWaterCacheKey& InKey) const;
+
+	void OnActorAdded(AActor* InActor);
+	void OnActorRemoved(AActor* InActor);
+	void OnActorSpawned(AActor* InActor);
+	void OnActorDestroyed(AActor* InActor);
+	void OnLevelAdded(ULevel* InLevel, UWorld* InWorld);
+	void OnLevelRemoved(ULevel* InLevel, UWorld* InWorld);
+
+#if WITH_EDITOR
+	void OnActorMoved(AActor* InActor);
+	void OnObjectPropertyChanged(UObject* InObject, FPropertyChangedEvent& InEvent);
+
+	/**
+	* Marks the area covered by the water body, before and after the change, as dirty, and has the edits processed on the next tick.
+	* bInInteractive is set for the intermediate changes of an edit still in progress (ie. a spline point being dragged).
+	*/
+	void OnWaterBodyEdited(AWaterBody* InWaterBody, bool bInInteractive = false);
+
+	/**
+	* Refreshes the components reading the dirty region. Once the edits settle, rebakes the snapshots read in this world that contain an edited body
+	* or overlap the edits, unless some of their bodies aren't loaded (see UPCGWaterSnapshot::CanRebuildFromLoadedWater), and refreshes the components reading them.
+	* Keeps ticking while a rebake is pending.
+	*/
+	bool ProcessWaterEdits(float InDeltaTime);
+
+	/**
+	* Refreshes the components of the world whose graph reads water by region (see UPCGGetWaterSettings::IsTrackingWaterByRegion) and overlaps the dirty bounds,
+	* or reads one of the rebuilt snapshots. Partitioned graphs are refreshed through their local components, so only the cells touched by an edit are regenerated.
+	*/
+	void RefreshWaterConsumers(const FBox& InDirtyBounds, TConstArrayView<const UPCGWaterSnapshot*> InRebuiltSnapshots);
+#endif
+
+	TArray<TWeakObjectPtr<AWaterBody>> WaterBodies;
+
+	/** Index over WaterBodies grid bounds, rebuilt lazily when bodies are added, removed or moved. */
+	FPCGWaterBodyIndex WaterBodyIndex;
+	bool bIndexDirty = true;
+	bool bRegisteredExistingWaterBodies = false;
+
+	/** Distance fields shared by the nodes, oldest first. Accessed from any thread, under DistanceFieldsLock. */
+	TArray<TPair<FPCGWaterCacheKey, TSharedFuture<TSharedPtr<const FPCGWaterDistanceField>>>> DistanceFields;
+	FCriticalSection DistanceFieldsLock;
+
+	/** Water data shared by the partition cells, oldest first, kept alive by the entries and by the callers still using it. Accessed from any thread, under WaterDataLock. */
+	TArray<TPair<FPCGWaterCacheKey, TSharedFuture<TStrongObjectPtr<UPCGWaterData>>>> SharedWaterData;
+
+	FCriticalSection WaterDataLock;
+
+	/** See GetWaterBodyRevision. Written on the game thread, read from any thread under WaterBodyRevisionsLock. */
+	TMap<FSoftObjectPath, uint32> WaterBodyRevisions;
+	mutable FCriticalSection WaterBodyRevisionsLock;
+
+	FDelegateHandle ActorSpawnedHandle;
+	FDelegateHandle ActorDestroyedHandle;
+	FDelegateHandle LoadedActorAddedHandle;
+	FDelegateHandle LoadedActorRemovedHandle;
+	FDelegateHandle LevelAddedHandle;
+	FDelegateHandle LevelRemovedHandle;
+
+#if WITH_EDITOR
+	FDelegateHandle ActorMovedHandle;
+	FDelegateHandle ObjectPropertyChangedHandle;
+
+	/** Last known grid bounds of the water bodies, so moving a body also dirties where it was. */
+	TMap<TObjectKey<AWaterBody>, FBox> LastWaterBodyBounds;
+
+	/** Area touched by the edits not processed yet. */
+	FBox PendingDirtyBounds = FBox(EForceInit::ForceInit);
+
+	/** Bodies and area touched by the edits since the snapshots were last rebaked. */
+	TArray<FSoftObjectPath> PendingSnapshotBodies;
+	FBox PendingSnapshotBounds = FBox(EForceInit::ForceInit);
+
+	/** When the last water edit happened, in FPlatformTime::Seconds, and whether it was an intermediate change. Snapshots are only rebaked once the edits settle. */
+	double LastWaterEditTime = 0.0;
+	bool bLastWaterEditInteractive = false;
+
+	FTSTicker::FDelegateHandle WaterEditsTickerHandle;
+#endif
+};